@@ -2,12 +2,64 @@
 #define AGENT_H_
 
 #include "types.h"
+#include "game_record.h"
+#include "solution_cache.h"
 
 #include <iosfwd>
 
 template <typename SelectionPolicy>
 double run(std::istream& ifs, bool enable_viewer = false);
 
+/**
+ * Same as above, with a policy which was already set up by the caller.
+ */
+template <typename SelectionPolicy>
+double run(std::istream& ifs, SelectionPolicy& selection_policy,
+           bool enable_viewer = false);
+
+/**
+ * Same as above, starting from an already parsed board.
+ */
+template <typename SelectionPolicy>
+double run(const Board& board, bool enable_viewer = false);
+
+template <typename SelectionPolicy>
+double run(const Board& board, SelectionPolicy& selection_policy,
+           bool enable_viewer = false);
+
+/**
+ * Play until the end of the game from the current position of `sg`, which
+ * may be any instantiation of BasicSameGame, and return the score.
+ */
+template <typename Game, typename SelectionPolicy>
+double play(Game& sg, SelectionPolicy& selection_policy,
+            bool enable_viewer = false);
+
+/**
+ * Same as above, also recording the board hash, the moves and the score of
+ * the game in `record`. Its seed is left to the caller.
+ */
+template <typename Game, typename SelectionPolicy>
+double play(Game& sg, SelectionPolicy& selection_policy, GameRecord& record);
+
+/**
+ * Same as above, starting from the best line known for the board in
+ * `cache`. The policies with a `set_incumbent()` method, see PolicyNMCS,
+ * search for a better line from there, the others play it back at once. The
+ * game is stored back in the cache if it beats the known line.
+ */
+template <typename Game, typename SelectionPolicy>
+double play(Game& sg, SelectionPolicy& selection_policy, SolutionCache& cache,
+            GameRecord& record);
+
+/**
+ * Play a board, starting from the best line known for it in `cache`, see
+ * above.
+ */
+template <typename SelectionPolicy>
+double run(const Board& board, SelectionPolicy& selection_policy,
+           SolutionCache& cache);
+
 
 #include "agent.hpp"
 #endif // AGENT_H_
@@ -1,28 +1,101 @@
 #ifndef AGENT_HPP_
 #define AGENT_HPP_
 
+#include "board_io.h"
+#include "game_record.h"
 #include "samegame.h"
+#include "stats.h"
 #include "viewer.h"
 
 #include <iostream>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace detail {
+
+// Whether a policy can start from a known line, see PolicyNMCS.
+template <typename SelectionPolicy, typename Game, typename = void>
+struct has_incumbent : std::false_type {};
+
+template <typename SelectionPolicy, typename Game>
+struct has_incumbent<
+    SelectionPolicy, Game,
+    std::void_t<decltype(std::declval<SelectionPolicy &>().set_incumbent(
+        std::declval<const Game &>(), 0.0,
+        std::declval<const std::vector<Action> &>()))>> : std::true_type {};
+
+} // namespace detail
 
 template <typename SelectionPolicy> double run(std::istream &ifs, bool enable_viewer) {
+  SelectionPolicy selection_policy;
+  return run(ifs, selection_policy, enable_viewer);
+}
+
+template <typename SelectionPolicy>
+double run(std::istream &ifs, SelectionPolicy &selection_policy,
+           bool enable_viewer) {
+  Board board;
+  if (not BoardIO::read(ifs, board)) {
+    throw std::runtime_error("Invalid board");
+  }
+  return run(board, selection_policy, enable_viewer);
+}
+
+template <typename SelectionPolicy>
+double run(const Board &board, bool enable_viewer) {
+  SelectionPolicy selection_policy;
+  return run(board, selection_policy, enable_viewer);
+}
+
+template <typename SelectionPolicy>
+double run(const Board &board, SelectionPolicy &selection_policy,
+           bool enable_viewer) {
   SameGame sg{WIDTH, HEIGHT};
-  sg.load(ifs);
+  sg.load(board);
+  return play(sg, selection_policy, enable_viewer);
+}
+
+template <typename SelectionPolicy>
+double run(const Board &board, SelectionPolicy &selection_policy,
+           SolutionCache &cache) {
+  SameGame sg{WIDTH, HEIGHT};
+  sg.load(board);
+  GameRecord record{};
+  return play(sg, selection_policy, cache, record);
+}
+
+namespace detail {
 
+// The decision loop of the play() overloads, recording the game unless the
+// record is null.
+template <typename Game, typename SelectionPolicy>
+double play(Game &sg, SelectionPolicy &selection_policy, bool enable_viewer,
+            GameRecord *record) {
   if(enable_viewer)
     Viewer::print(std::cout, sg);
 
-  SelectionPolicy selection_policy;
+  if (record) {
+    record->board_hash = sg.hash();
+    record->moves.clear();
+  }
+
   double score = 0.0;
 
   while (true) {
-    auto [okay, action] = selection_policy(sg);
+    auto [okay, action] = [&] {
+      SG_STATS_TIMER(Decision);
+      return selection_policy(sg);
+    }();
 
     if (not okay) {
       break;
     }
 
+    if (record) {
+      record->moves.push_back(Records::encode_move(sg, action));
+    }
     score += sg.score(action);
     sg.apply(action);
 
@@ -37,6 +110,50 @@ template <typename SelectionPolicy> double run(std::istream &ifs, bool enable_vi
     std::cout << "\n\nScore: " << score << std::endl;
   }
 
+  if (record) {
+    record->score = score;
+  }
+  return score;
+}
+
+} // namespace detail
+
+template <typename Game, typename SelectionPolicy>
+double play(Game &sg, SelectionPolicy &selection_policy, bool enable_viewer) {
+  return detail::play(sg, selection_policy, enable_viewer, nullptr);
+}
+
+template <typename Game, typename SelectionPolicy>
+double play(Game &sg, SelectionPolicy &selection_policy, GameRecord &record) {
+  return detail::play(sg, selection_policy, false, &record);
+}
+
+template <typename Game, typename SelectionPolicy>
+double play(Game &sg, SelectionPolicy &selection_policy, SolutionCache &cache,
+            GameRecord &record) {
+  std::vector<Action> line;
+  double known_score = 0.0;
+  const bool valid = cache.lookup(sg, line, known_score);
+
+  if (valid) {
+    if constexpr (detail::has_incumbent<SelectionPolicy, Game>::value) {
+      selection_policy.set_incumbent(sg, known_score, line);
+    } else {
+      record.board_hash = sg.hash();
+      record.moves.clear();
+      for (const Action &action : line) {
+        record.moves.push_back(Records::encode_move(sg, action));
+        sg.apply(action);
+      }
+      record.score = known_score;
+      return known_score;
+    }
+  }
+
+  const double score = play(sg, selection_policy, record);
+  if (not valid || score > known_score) {
+    cache.store(record);
+  }
   return score;
 }
 
@@ -0,0 +1,139 @@
+#include "anytime.h"
+
+#include <algorithm>
+
+PolicyAnytime::PolicyAnytime(const TimeControl &time, int max_level,
+                             unsigned seed)
+    : m_time{time}, m_max_level{max_level}, m_completed_level{0},
+      m_best{0.0, {}}, m_expected_hash{0}, m_root{WIDTH, HEIGHT},
+      m_nmcs{max_level, seed}, m_result{0.0, {}} {
+  const size_t max_moves = WIDTH * HEIGHT / 2;
+  m_best.moves.reserve(max_moves);
+  m_result.moves.reserve(max_moves);
+}
+
+std::pair<bool, Action> PolicyAnytime::operator()(const SameGame &sg) {
+  // A position other than the expected one starts a new game.
+  if (sg.hash() != m_expected_hash) {
+    m_game_deadline = Deadline::in(m_time.per_game);
+    m_root.set_state(sg.state());
+    greedy_playout();
+    m_expected_hash = sg.hash();
+  }
+
+  // Share the time left between the moves expected until the end.
+  Deadline deadline = Deadline::in(m_time.per_move);
+  if (not m_game_deadline.never() && not m_best.moves.empty()) {
+    deadline = min(deadline, Deadline::in(m_game_deadline.remaining() /
+                                          m_best.moves.size()));
+  }
+
+  return play(sg, deadline);
+}
+
+std::pair<bool, Action> PolicyAnytime::play(const SameGame &sg,
+                                            const Deadline &deadline) {
+  search(sg, deadline);
+
+  if (m_best.moves.empty()) {
+    return std::make_pair(false, Action{-1});
+  }
+
+  const Action action = m_best.moves.front();
+  m_best.score -= m_root.score(action);
+  m_best.moves.erase(m_best.moves.begin());
+
+  m_root.apply(action);
+  m_expected_hash = m_root.hash();
+
+  return std::make_pair(true, action);
+}
+
+void PolicyAnytime::advance(const SameGame &sg, const Action &action) {
+  if (sg.hash() != m_expected_hash) {
+    return;
+  }
+
+  // Compare the clusters, the action may name any of their cells.
+  const bool follows =
+      not m_best.moves.empty() &&
+      m_root.get_cluster(action.index).rep ==
+          m_root.get_cluster(m_best.moves.front().index).rep;
+
+  if (follows) {
+    const Action head = m_best.moves.front();
+    m_best.score -= m_root.score(head);
+    m_best.moves.erase(m_best.moves.begin());
+    m_root.apply(head);
+  } else {
+    m_root.apply(Action{m_root.get_cluster(action.index).rep});
+    greedy_playout();
+  }
+  m_expected_hash = m_root.hash();
+}
+
+const PolicyAnytime::Sequence &
+PolicyAnytime::search(const SameGame &sg, const Deadline &deadline) {
+  if (sg.hash() != m_expected_hash) {
+    m_root.set_state(sg.state());
+    greedy_playout();
+    m_expected_hash = sg.hash();
+  }
+
+  m_completed_level = 0;
+  if (m_best.moves.empty()) {
+    return m_best;
+  }
+  m_nmcs.set_deadline(deadline);
+
+  for (int level = 1; not deadline.expired(); ++level) {
+    if (level > m_max_level) {
+      if (deadline.never()) {
+        break;
+      }
+      level = m_max_level;
+    }
+
+    m_nmcs.search(m_root.state(), level, m_result);
+
+    // A search cut short has still found complete sequences, if any.
+    if (m_result.score > m_best.score) {
+      std::swap(m_best, m_result);
+    }
+    if (not deadline.expired()) {
+      m_completed_level = std::max(m_completed_level, level);
+    }
+  }
+
+  m_nmcs.set_deadline(Deadline{});
+  return m_best;
+}
+
+void PolicyAnytime::set_incumbent(const SameGame &sg, double score,
+                                  const std::vector<Action> &moves) {
+  m_game_deadline = Deadline::in(m_time.per_game);
+  m_root.set_state(sg.state());
+  m_best.score = score;
+  m_best.moves.assign(moves.begin(), moves.end());
+  m_expected_hash = sg.hash();
+}
+
+void PolicyAnytime::greedy_playout() {
+  m_best.score = 0.0;
+  m_best.moves.clear();
+
+  PolicyGreedy greedy;
+  for (int n = 0;; ++n) {
+    auto [okay, action] = greedy(m_root);
+    if (not okay) {
+      // Back to the starting position.
+      for (; n > 0; --n) {
+        m_root.undo();
+      }
+      return;
+    }
+    m_best.score += m_root.score(action);
+    m_best.moves.push_back(action);
+    m_root.apply(action);
+  }
+}
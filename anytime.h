@@ -0,0 +1,107 @@
+#ifndef ANYTIME_H_
+#define ANYTIME_H_
+
+#include "deadline.h"
+#include "policy.h"
+#include "samegame.h"
+
+#include <chrono>
+#include <random>
+#include <vector>
+
+/**
+ * Time allowed to a policy, on the monotonic clock.
+ */
+struct TimeControl {
+  // Longest time spent on a single move.
+  Deadline::Clock::duration per_move;
+  // Longest time spent on a whole game, shared between its moves.
+  Deadline::Clock::duration per_game = Deadline::Clock::duration::max();
+};
+
+/**
+ * Search which improves its result for as long as it is given.
+ *
+ * A best sequence is always ready: it starts with a greedy playout, and is
+ * replaced by the results of #PolicyNMCS searches of increasing level
+ * whenever they beat it, until the deadline expires. Once the deepest level
+ * is reached, it keeps running searches of that level, with new playouts.
+ *
+ * As a policy, every move gets the smaller of the time per move and an even
+ * share of the time left for the game, counting one share per move of the
+ * best sequence.
+ */
+class PolicyAnytime {
+public:
+  using Sequence = PolicyNMCS::Sequence;
+
+  /**
+   * @Param time  The time allowed to the moves and the games.
+   * @Param max_level  The deepest level of the nested searches.
+   */
+  explicit PolicyAnytime(const TimeControl &time, int max_level = 3,
+                         unsigned seed = std::random_device{}());
+
+  std::pair<bool, Action> operator()(const SameGame &sg);
+
+  /**
+   * Same as above, searching until `deadline` whatever the time control.
+   */
+  std::pair<bool, Action> play(const SameGame &sg, const Deadline &deadline);
+
+  /**
+   * Improve the best sequence from the position of `sg` until `deadline`,
+   * which overruns by at most one batch of playouts. Without a deadline,
+   * the searches stop after the deepest level.
+   *
+   * @Return  The best sequence found, scored from `sg`, which is empty
+   *          only if the game is over.
+   */
+  const Sequence &search(const SameGame &sg, const Deadline &deadline);
+
+  /**
+   * Follow a move played on `sg` by someone else, keeping the rest of the
+   * best sequence if it started with that move. Does nothing unless `sg`
+   * is the position expected at the next call, as after play().
+   */
+  void advance(const SameGame &sg, const Action &action);
+
+  /**
+   * The deepest level completed by the last search, 0 if it only has the
+   * greedy playout.
+   */
+  int level() const { return m_completed_level; }
+
+  /**
+   * Start a game from a known line of the position of `sg`, instead of a
+   * greedy playout.
+   *
+   * @Param score  The score of the line, from `sg`.
+   */
+  void set_incumbent(const SameGame &sg, double score,
+                     const std::vector<Action> &moves);
+
+private:
+  TimeControl m_time;
+  int m_max_level;
+  int m_completed_level;
+
+  // Deadline of the game being played.
+  Deadline m_game_deadline;
+
+  // Best sequence found from the position expected at the next call.
+  Sequence m_best;
+  uint64_t m_expected_hash;
+
+  SameGame m_root;
+  PolicyNMCS m_nmcs;
+  Sequence m_result;
+
+  /**
+   * Reset the best sequence to a greedy playout from the position of
+   * `m_root`.
+   */
+  void greedy_playout();
+};
+
+#endif // ANYTIME_H_
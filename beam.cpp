@@ -0,0 +1,106 @@
+#include "beam.h"
+
+#include <algorithm>
+#include <limits>
+
+PolicyBeam::PolicyBeam(size_t width, int depth, Evaluation evaluation)
+    : m_width{width}, m_depth{depth}, m_evaluation{std::move(evaluation)},
+      m_scratch{WIDTH, HEIGHT} {
+  const size_t max_actions = WIDTH * HEIGHT / 2;
+
+  m_parents.reserve(width);
+  m_layer.reserve(width);
+  m_next_layer.reserve(width);
+  m_candidates.reserve(width * max_actions);
+  m_selected.reserve(width);
+  m_moves.reserve(max_actions);
+}
+
+double PolicyBeam::default_evaluation(const SameGame &, double score) {
+  return score;
+}
+
+std::pair<bool, Action> PolicyBeam::operator()(const SameGame &sg) {
+  m_layer.clear();
+  m_layer.push_back(Node{sg.state(), 0.0, Action{-1}, -1, Action{-1}});
+
+  Action best_first{-1};
+  double best_value = -std::numeric_limits<double>::infinity();
+
+  for (int depth = 0; depth < m_depth && not m_layer.empty(); ++depth) {
+
+    // Expand and evaluate every child of the layer.
+    m_candidates.clear();
+    for (int p = 0; p < m_layer.size(); ++p) {
+      Node &node = m_layer[p];
+
+      if (node.parent < 0) {
+        m_scratch.set_state(node.state);
+      } else {
+        if (p == 0 || m_layer[p - 1].parent != node.parent) {
+          m_scratch.set_state(m_parents[node.parent].state);
+        }
+        m_scratch.apply(node.action);
+        node.state = m_scratch.state();
+      }
+
+      m_moves.clear();
+      m_scratch.moves(std::back_inserter(m_moves));
+
+      for (const Move &move : m_moves) {
+        const double score = node.score + move.score;
+        m_scratch.apply(move.action);
+        m_candidates.push_back(Candidate{
+            m_evaluation(m_scratch, score), score, m_scratch.hash(), p,
+            move.action, depth == 0 ? move.action : node.first});
+        m_scratch.undo();
+      }
+
+      // Back to the parent, for its next child.
+      if (node.parent >= 0) {
+        m_scratch.undo();
+      }
+    }
+
+    std::sort(m_candidates.begin(), m_candidates.end(),
+              [](const auto &a, const auto &b) { return a.value > b.value; });
+
+    // Keep the best ones, skipping the positions already reached through
+    // another sequence of moves.
+    m_next_layer.clear();
+    m_selected.clear();
+    for (const Candidate &candidate : m_candidates) {
+      if (m_next_layer.size() == m_width) {
+        break;
+      }
+      if (std::find(m_selected.begin(), m_selected.end(), candidate.hash) !=
+          m_selected.end()) {
+        continue;
+      }
+      m_selected.push_back(candidate.hash);
+
+      m_next_layer.push_back(Node{{},
+                                  candidate.score,
+                                  candidate.first,
+                                  candidate.parent,
+                                  candidate.action});
+
+      if (candidate.value > best_value) {
+        best_value = candidate.value;
+        best_first = candidate.first;
+      }
+    }
+
+    // A parent has a single child per action, the order is strict.
+    std::sort(m_next_layer.begin(), m_next_layer.end(),
+              [](const Node &a, const Node &b) {
+                return a.parent != b.parent ? a.parent < b.parent
+                                            : a.action.index < b.action.index;
+              });
+
+    std::swap(m_parents, m_layer);
+    std::swap(m_layer, m_next_layer);
+  }
+
+  return std::make_pair(best_first.index != -1, best_first);
+}
@@ -0,0 +1,76 @@
+#ifndef BEAM_H_
+#define BEAM_H_
+
+#include "samegame.h"
+
+#include <functional>
+#include <vector>
+
+/**
+ * Beam search.
+ *
+ * From the current position, every valid action of the nodes of a layer is
+ * expanded and evaluated, and the `width` best children form the next
+ * layer, up to `depth` layers. The first action leading to the best node
+ * found is played.
+ *
+ * Nodes live in three preallocated layers which are rotated at every depth,
+ * so a search does not allocate. A node is only reached when its layer is
+ * expanded, by applying its action to the state of its parent, the nodes
+ * of a layer being grouped by parent so that each parent is set up once.
+ */
+class PolicyBeam {
+public:
+  /**
+   * Value of a position for the beam, higher is better.
+   *
+   * @Param sg  The position.
+   * @Param score  The score collected from the root to the position.
+   */
+  using Evaluation = std::function<double(const SameGame &sg, double score)>;
+
+  explicit PolicyBeam(size_t width = 32, int depth = 6,
+                      Evaluation evaluation = default_evaluation);
+
+  std::pair<bool, Action> operator()(const SameGame &sg);
+
+  /**
+   * The score collected so far.
+   */
+  static double default_evaluation(const SameGame &sg, double score);
+
+private:
+  struct Node {
+    // Set when the layer of the node is expanded, except for the root.
+    SameGame::State state;
+    double score;
+    Action first;
+    // Index in the previous layer, -1 for the root.
+    int parent;
+    Action action;
+  };
+
+  // A child waiting for selection, which is not worth a full state yet.
+  struct Candidate {
+    double value;
+    double score;
+    uint64_t hash;
+    int parent;
+    Action action;
+    Action first;
+  };
+
+  size_t m_width;
+  int m_depth;
+  Evaluation m_evaluation;
+
+  SameGame m_scratch;
+  std::vector<Node> m_parents;
+  std::vector<Node> m_layer;
+  std::vector<Node> m_next_layer;
+  std::vector<Candidate> m_candidates;
+  std::vector<uint64_t> m_selected;
+  std::vector<Move> m_moves;
+};
+
+#endif // BEAM_H_
@@ -0,0 +1,671 @@
+#include "types.h"
+#include "board_io.h"
+#include "cli.h"
+#include "dsu.h"
+#include "parallel.h"
+#include "playout_batch.h"
+#include "policy.h"
+#include "vec_env.h"
+#include "samegame.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+using Clock = chrono::steady_clock;
+
+/**
+ * Access to the private steps of SameGame::apply().
+ */
+class Benchmark {
+public:
+  static void clear_cluster(SameGame &sg, int index) {
+    sg.clear_cluster(index);
+  }
+  static void gravity(SameGame &sg) { sg.gravity(); }
+  static void stack_columns(SameGame &sg) { sg.stack_columns(); }
+
+#ifdef SG_BITBOARD
+  static void compute_clusters(SameGame &sg) {
+    sg.m_dirty_columns = (uint64_t{1} << (WIDTH - 1) << 1) - 1;
+    sg.compute_clusters();
+  }
+  static void update_clusters(SameGame &sg) { sg.compute_clusters(); }
+#else
+  static void compute_clusters(SameGame &sg) { sg.compute_clusters(); }
+  static void update_clusters(SameGame &sg) { sg.update_clusters(); }
+#endif
+};
+
+namespace {
+
+struct Options {
+  string boards = DATA_DIR + string("test*.txt");
+  int rounds = 20;
+  int midgame = 4;
+  unsigned seed = 0;
+  bool csv = false;
+  string baseline;
+  double tolerance = 0.10;
+  size_t threads = thread::hardware_concurrency();
+};
+
+// Time per call of one operation, that of its fastest round, which leaves
+// out most of the noise of the machine.
+struct Measure {
+  // Total time and number of calls of the current round.
+  double ns = 0.0;
+  size_t ops = 0;
+  double best = INFINITY;
+
+  void end_round() {
+    if (ops > 0) {
+      best = min(best, ns / ops);
+    }
+    ns = 0.0;
+    ops = 0;
+  }
+
+  double ns_per_op() const { return best; }
+};
+
+void end_round(map<string, Measure> &results) {
+  for (auto &[name, m] : results) {
+    m.end_round();
+  }
+}
+
+void print_usage(const char *prog) {
+  cerr << "USAGE: " << prog << " [OPTIONS]\n\n"
+       << "  --boards PATTERN    Glob pattern of the board files\n"
+       << "                      (default: " << DATA_DIR << "test*.txt)\n"
+       << "  --rounds N          Passes over the positions (default: 20)\n"
+       << "  --midgame N         Random mid-game positions per board\n"
+       << "                      (default: 4)\n"
+       << "  --seed S            Seed of the mid-game positions (default: 0)\n"
+       << "  --threads N         Most threads of the root parallel search\n"
+       << "                      (default: hardware concurrency)\n"
+       << "  --csv               Print the results as CSV\n"
+       << "  --baseline FILE     Compare with results saved with --csv, and\n"
+       << "                      fail on any regression\n"
+       << "  --tolerance T       Relative slowdown allowed by --baseline\n"
+       << "                      (default: 0.10)\n";
+}
+
+bool parse_options(int argc, char *argv[], Options &options) {
+  for (int i = 1; i < argc; ++i) {
+    const string arg = argv[i];
+    const bool has_value = i + 1 < argc;
+
+    try {
+      if (arg == "--csv") {
+        options.csv = true;
+      } else if (arg == "--boards" && has_value) {
+        options.boards = argv[++i];
+      } else if (arg == "--rounds" && has_value) {
+        options.rounds = Cli::parse_unsigned<int>(argv[++i]);
+      } else if (arg == "--midgame" && has_value) {
+        options.midgame = Cli::parse_unsigned<int>(argv[++i]);
+      } else if (arg == "--seed" && has_value) {
+        options.seed = Cli::parse_unsigned<unsigned>(argv[++i]);
+      } else if (arg == "--threads" && has_value) {
+        options.threads = Cli::parse_unsigned<size_t>(argv[++i]);
+      } else if (arg == "--baseline" && has_value) {
+        options.baseline = argv[++i];
+      } else if (arg == "--tolerance" && has_value) {
+        options.tolerance = Cli::parse_double(argv[++i]);
+      } else {
+        return false;
+      }
+    } catch (const logic_error &) {
+      // std::invalid_argument or std::out_of_range from the parsers.
+      cerr << "Invalid value for " << arg << endl;
+      return false;
+    }
+  }
+  return options.rounds > 0 && options.threads > 0 &&
+         options.tolerance >= 0.0;
+}
+
+/**
+ * The starting positions of the boards, followed by positions reached
+ * after a random number of random moves from them.
+ */
+vector<SameGame::State> make_positions(const vector<string> &files,
+                                       const Options &options) {
+  vector<SameGame::State> positions;
+  SameGame sg{WIDTH, HEIGHT};
+  PolicyRandom policy{options.seed};
+  mt19937 gen{options.seed};
+
+  for (const string &fn : files) {
+    ifstream ifs{fn};
+    sg.load(ifs);
+    positions.push_back(sg.state());
+  }
+
+  for (size_t b = 0, n = positions.size(); b < n; ++b) {
+    for (int k = 0; k < options.midgame; ++k) {
+      sg.set_state(positions[b]);
+
+      const int n_moves = uniform_int_distribution<>(5, 30)(gen);
+      for (int m = 0; m < n_moves; ++m) {
+        auto [okay, action] = policy(sg);
+        if (not okay) {
+          break;
+        }
+        sg.apply(action);
+      }
+      positions.push_back(sg.state());
+    }
+  }
+
+  return positions;
+}
+
+// Average cost of reading the clock, subtracted from single call timings.
+double clock_overhead_ns() {
+  constexpr int n = 100000;
+  const auto start = Clock::now();
+  for (int i = 0; i < n; ++i) {
+    [[maybe_unused]] volatile auto t = Clock::now();
+  }
+  return chrono::duration<double, nano>(Clock::now() - start).count() / n;
+}
+
+double elapsed_ns(Clock::time_point a, Clock::time_point b) {
+  return chrono::duration<double, nano>(b - a).count();
+}
+
+/**
+ * Time a single call of f, counted as `n_ops` calls of the operation
+ * `name`, less the overhead of reading the clock.
+ */
+template <typename F>
+void timed(map<string, Measure> &results, const string &name, size_t n_ops,
+           F &&f, double overhead = 0.0) {
+  const auto start = Clock::now();
+  f();
+  const auto stop = Clock::now();
+  Measure &m = results[name];
+  m.ns += max(elapsed_ns(start, stop) - overhead, 0.0);
+  m.ops += n_ops;
+}
+
+/**
+ * Time n calls of f at once.
+ */
+template <typename F>
+void timed_n(map<string, Measure> &results, const string &name, size_t n,
+             F &&f) {
+  timed(results, name, n, [&] {
+    for (size_t k = 0; k < n; ++k) {
+      f();
+    }
+  });
+}
+
+// The cells united when building the clusters of a position from scratch.
+vector<pair<int, int>> same_color_pairs(const SameGame &sg) {
+  vector<pair<int, int>> pairs;
+  for (int y = 0; y < HEIGHT; ++y) {
+    for (int x = 0; x < WIDTH; ++x) {
+      const int i = x + y * WIDTH;
+      const Color color = sg.get_color(i);
+      if (color == Color::Empty) {
+        continue;
+      }
+      if (x + 1 < WIDTH && sg.get_color(i + 1) == color)
+        pairs.emplace_back(i, i + 1);
+      if (y + 1 < HEIGHT && sg.get_color(i + WIDTH) == color)
+        pairs.emplace_back(i, i + WIDTH);
+    }
+  }
+  return pairs;
+}
+
+map<string, Measure> run_benchmarks(const vector<SameGame::State> &positions,
+                                    const Options &options) {
+  map<string, Measure> results;
+  const double overhead = clock_overhead_ns();
+
+  SameGame sg{WIDTH, HEIGHT};
+  vector<Action> actions;
+  actions.reserve(WIDTH * HEIGHT);
+  vector<Move> moves;
+  moves.reserve(WIDTH * HEIGHT);
+  double sink = 0.0;
+
+  for (int round = 0; round < options.rounds; ++round) {
+    for (const SameGame::State &state : positions) {
+      sg.set_state(state);
+      actions.clear();
+      sg.valid_actions(std::back_inserter(actions));
+
+      timed_n(results, "valid_actions", 16, [&] {
+        actions.clear();
+        sg.valid_actions(std::back_inserter(actions));
+      });
+
+      timed_n(results, "moves", 16, [&] {
+        moves.clear();
+        sg.moves(std::back_inserter(moves));
+      });
+
+      timed_n(results, "score", 16 * actions.size(),
+              [&, k = size_t{0}]() mutable {
+                sink += sg.score(actions[k++ % actions.size()]);
+              });
+
+      timed_n(results, "compute_clusters", 16,
+              [&] { Benchmark::compute_clusters(sg); });
+
+      for (const Action &action : actions) {
+        sg.set_state(state);
+        timed(results, "apply", 1, [&] { sg.apply(action); }, overhead);
+        timed(results, "undo", 1, [&] { sg.undo(); }, overhead);
+
+        timed(
+            results, "clear_cluster", 1,
+            [&] { Benchmark::clear_cluster(sg, action.index); }, overhead);
+        timed(results, "gravity", 1, [&] { Benchmark::gravity(sg); },
+              overhead);
+        timed(results, "stack_columns", 1,
+              [&] { Benchmark::stack_columns(sg); }, overhead);
+        timed(results, "update_clusters", 1,
+              [&] { Benchmark::update_clusters(sg); }, overhead);
+      }
+
+      const auto pairs = same_color_pairs(sg);
+      DSU dsu;
+
+      timed_n(results, "DSU::unite", pairs.size(),
+              [&, k = size_t{0}]() mutable {
+                dsu.unite(pairs[k].first, pairs[k].second);
+                ++k;
+              });
+
+      timed_n(results, "DSU::find_rep", WIDTH * HEIGHT,
+              [&, i = 0]() mutable { sink += dsu.find_rep(i++); });
+    }
+    end_round(results);
+  }
+
+  // Keep the compiler from optimizing the loops away.
+  if (sink == -1.0) {
+    cerr << sink;
+  }
+
+  return results;
+}
+
+/**
+ * Time the parsing of the text boards and the loading of parsed boards.
+ */
+void run_load_benchmarks(const vector<string> &files, const Options &options,
+                         map<string, Measure> &results) {
+  vector<string> texts;
+  for (const string &fn : files) {
+    ifstream ifs{fn};
+    ostringstream oss;
+    oss << ifs.rdbuf();
+    texts.push_back(oss.str());
+  }
+
+  SameGame sg{WIDTH, HEIGHT};
+  Board board;
+  size_t n_parsed = 0;
+
+  for (int round = 0; round < options.rounds; ++round) {
+    for (const string &text : texts) {
+      timed_n(results, "BoardIO::parse", 16, [&] {
+        n_parsed += BoardIO::parse(text.data(), text.data() + text.size(),
+                                   board) != nullptr;
+      });
+      timed_n(results, "load", 16, [&] { sg.load(board); });
+    }
+    end_round(results);
+  }
+
+  if (n_parsed != 16 * options.rounds * texts.size()) {
+    cerr << "Some boards failed to parse" << endl;
+  }
+}
+
+/**
+ * Time random playouts from the positions, one board at a time and on a
+ * PlayoutBatch, counting one op per playout.
+ */
+void run_playout_benchmarks(const vector<SameGame::State> &positions,
+                            const Options &options,
+                            map<string, Measure> &results) {
+  SameGame sg{WIDTH, HEIGHT};
+  PolicyRandom policy{options.seed};
+  PlayoutBatch batch{options.seed};
+  double sink = 0.0;
+
+  for (int round = 0; round < options.rounds; ++round) {
+    for (const SameGame::State &state : positions) {
+      timed(results, "playout", 1, [&] {
+        sg.set_state(state);
+        while (true) {
+          auto [okay, action] = policy(sg);
+          if (not okay) {
+            break;
+          }
+          sink += sg.score(action);
+          sg.apply(action);
+        }
+      });
+    }
+
+    for (size_t first = 0; first < positions.size();
+         first += PlayoutBatch::LANES) {
+      const size_t n = min(PlayoutBatch::LANES, positions.size() - first);
+      timed(results, "PlayoutBatch::run", n, [&] {
+        batch.clear();
+        for (size_t l = 0; l < n; ++l) {
+          sg.set_state(positions[first + l]);
+          batch.load(l, sg);
+        }
+        batch.run(PlayoutBatch::Policy::Random);
+        sink += batch.score(0);
+      });
+    }
+    end_round(results);
+  }
+
+  if (sink == -1.0) {
+    cerr << sink;
+  }
+}
+
+/**
+ * Time the first decision of a root parallel search from every position,
+ * with 1, 2, 4, ... threads up to `options.threads`, counting one op
+ * per decision. The decisions are much slower than the other operations, at
+ * most 3 rounds are made.
+ */
+void run_parallel_benchmarks(const vector<SameGame::State> &positions,
+                             const Options &options,
+                             map<string, Measure> &results) {
+  const size_t max_threads = options.threads;
+  SameGame sg{WIDTH, HEIGHT};
+
+  for (size_t n_threads = 1;; n_threads = min(2 * n_threads, max_threads)) {
+    // Zero-padded, for the results to be listed by number of threads.
+    ostringstream name;
+    name << "root_parallel/" << setw(2) << setfill('0') << n_threads;
+
+    for (int round = 0; round < min(options.rounds, 3); ++round) {
+      PolicyRootParallel policy{1, n_threads, options.seed};
+      for (const SameGame::State &state : positions) {
+        sg.set_state(state);
+        timed(results, name.str(), 1, [&] { policy(sg); });
+      }
+      end_round(results);
+    }
+
+    if (n_threads == max_threads) {
+      break;
+    }
+  }
+}
+
+/**
+ * Time the encoding of the positions as observations, of both value types,
+ * checking once that their planes of valid actions match the moves.
+ */
+bool run_observation_benchmarks(const vector<SameGame::State> &positions,
+                                const Options &options,
+                                map<string, Measure> &results) {
+  constexpr size_t SIZE = Observation::size<SameGame>();
+  constexpr size_t PLANE = WIDTH * HEIGHT;
+  constexpr size_t VALID_PLANE = Observation::channels<SameGame>() - 1;
+
+  SameGame sg{WIDTH, HEIGHT};
+  vector<float> floats(SIZE);
+  vector<uint8_t> bytes(SIZE);
+  vector<Move> moves;
+
+  for (const SameGame::State &state : positions) {
+    sg.set_state(state);
+    Observation::encode(sg, bytes.data());
+
+    moves.clear();
+    sg.moves(back_inserter(moves));
+    size_t n_cells = 0;
+    for (const Move &move : moves) {
+      n_cells += move.size;
+    }
+    const uint8_t *valid = bytes.data() + VALID_PLANE * PLANE;
+    if (static_cast<size_t>(count(valid, valid + PLANE, 1)) != n_cells) {
+      cerr << "Observation::encode disagrees with the moves of a position"
+           << endl;
+      return false;
+    }
+  }
+
+  for (int round = 0; round < options.rounds; ++round) {
+    for (const SameGame::State &state : positions) {
+      sg.set_state(state);
+      timed_n(results, "Observation::encode<float>", 16,
+              [&] { Observation::encode(sg, floats.data()); });
+      timed_n(results, "Observation::encode<uint8_t>", 16,
+              [&] { Observation::encode(sg, bytes.data()); });
+    }
+    end_round(results);
+  }
+  return true;
+}
+
+/**
+ * Time VecEnv::step() on a batch of environments playing random valid
+ * actions, counting one op per environment stepped.
+ *
+ * Every environment is replayed on a plain game along the way, out of the
+ * timings, as a check of its rewards, done flags and masks.
+ *
+ * @Return  Whether the environments agreed with the games.
+ */
+bool run_env_benchmarks(const Options &options,
+                        map<string, Measure> &results) {
+  constexpr size_t N_ENVS = 64;
+  constexpr int STEPS_PER_ROUND = 100;
+  constexpr size_t N_ACTIONS = VecEnv::n_actions();
+
+  VecEnv env{N_ENVS, VecEnv::random_board, 1};
+  vector<SameGame> games(N_ENVS, SameGame{WIDTH, HEIGHT});
+  vector<uint64_t> next_seeds(N_ENVS);
+  Board board;
+
+  auto restart = [&](size_t i) {
+    VecEnv::random_board(next_seeds[i], board);
+    next_seeds[i] += N_ENVS;
+    games[i].load(board);
+  };
+
+  vector<uint64_t> seeds(N_ENVS);
+  for (size_t i = 0; i < N_ENVS; ++i) {
+    seeds[i] = next_seeds[i] = options.seed + i;
+    restart(i);
+  }
+  env.reset(seeds.data());
+
+  mt19937 gen{options.seed};
+  vector<int32_t> actions(N_ENVS);
+  vector<int32_t> valid;
+  vector<Move> moves;
+
+  auto mismatch = [](const char *what, size_t i) {
+    cerr << "VecEnv and SameGame disagree on the " << what
+         << " of environment " << i << endl;
+    return false;
+  };
+
+  for (int round = 0; round < options.rounds; ++round) {
+    for (int k = 0; k < STEPS_PER_ROUND; ++k) {
+      for (size_t i = 0; i < N_ENVS; ++i) {
+        const uint8_t *mask = env.masks() + i * N_ACTIONS;
+        valid.clear();
+        for (size_t c = 0; c < N_ACTIONS; ++c) {
+          if (mask[c]) {
+            valid.push_back(c);
+          }
+        }
+
+        // The valid cells are those of the clusters of the game.
+        moves.clear();
+        games[i].moves(back_inserter(moves));
+        size_t n_cells = 0;
+        for (const Move &move : moves) {
+          n_cells += move.size;
+        }
+        if (n_cells != valid.size()) {
+          return mismatch("mask", i);
+        }
+        actions[i] = valid.empty() ? 0
+                                   : valid[uniform_int_distribution<size_t>(
+                                         0, valid.size() - 1)(gen)];
+      }
+
+      timed(results, "VecEnv::step", N_ENVS,
+            [&] { env.step(actions.data()); });
+
+      for (size_t i = 0; i < N_ENVS; ++i) {
+        const Action action{games[i].get_cluster(actions[i]).rep};
+        if (not games[i].is_valid(action) ||
+            env.rewards()[i] != static_cast<float>(games[i].score(action))) {
+          return mismatch("reward", i);
+        }
+        games[i].apply(action);
+
+        const bool done = games[i].clusters().empty();
+        if (env.dones()[i] != done) {
+          return mismatch("done flag", i);
+        }
+        if (done) {
+          restart(i);
+        }
+      }
+    }
+    end_round(results);
+  }
+  return true;
+}
+
+/**
+ * Read results saved with --csv, failing with a message on an invalid file.
+ */
+bool read_baseline(const string &fn, map<string, double> &baseline) {
+  ifstream ifs{fn};
+  if (not ifs) {
+    cerr << "Failed to open baseline " << fn << endl;
+    return false;
+  }
+  string line;
+  getline(ifs, line); // Header
+
+  for (int line_number = 2; getline(ifs, line); ++line_number) {
+    istringstream iss{line};
+    string name, ns;
+    if (not getline(iss, name, ',') || not getline(iss, ns, ',')) {
+      continue;
+    }
+    try {
+      baseline[name] = Cli::parse_double(ns);
+    } catch (const logic_error &) {
+      cerr << "Invalid time on line " << line_number << " of " << fn
+           << endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  Options options;
+  if (not parse_options(argc, argv, options)) {
+    print_usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  const vector<string> files = Cli::glob_files(options.boards);
+  if (files.empty()) {
+    cerr << "No board matches " << options.boards << endl;
+    return EXIT_FAILURE;
+  }
+
+  const auto positions = make_positions(files, options);
+  auto results = run_benchmarks(positions, options);
+  run_load_benchmarks(files, options, results);
+  run_playout_benchmarks(positions, options, results);
+  run_parallel_benchmarks(positions, options, results);
+  const bool env_ok = run_observation_benchmarks(positions, options,
+                                                 results) &&
+                      run_env_benchmarks(options, results);
+
+  if (options.csv) {
+    cout << "name,ns_per_op,ops_per_s\n";
+    for (const auto &[name, m] : results) {
+      cout << name << ',' << m.ns_per_op() << ',' << 1e9 / m.ns_per_op()
+           << '\n';
+    }
+  } else {
+    cout << positions.size() << " positions, " << options.rounds
+         << " rounds\n\n"
+         << left << setw(30) << "Operation" << right << setw(12) << "ns/op"
+         << setw(16) << "ops/s" << '\n';
+    for (const auto &[name, m] : results) {
+      cout << left << setw(30) << name << right << fixed << setprecision(1)
+           << setw(12) << m.ns_per_op() << setprecision(0) << setw(16)
+           << 1e9 / m.ns_per_op() << '\n';
+    }
+  }
+
+  if (not env_ok) {
+    return EXIT_FAILURE;
+  }
+  if (options.baseline.empty()) {
+    return EXIT_SUCCESS;
+  }
+
+  map<string, double> baseline;
+  if (not read_baseline(options.baseline, baseline)) {
+    return EXIT_FAILURE;
+  }
+  bool regression = false;
+
+  cerr << '\n'
+       << left << setw(30) << "Operation" << right << setw(12) << "baseline"
+       << setw(12) << "current" << setw(10) << "speedup" << '\n';
+  for (const auto &[name, m] : results) {
+    const auto it = baseline.find(name);
+    if (it == baseline.end()) {
+      continue;
+    }
+    const double speedup = it->second / m.ns_per_op();
+    const bool slower = m.ns_per_op() > it->second * (1.0 + options.tolerance);
+    regression |= slower;
+
+    cerr << left << setw(30) << name << right << fixed << setprecision(1)
+         << setw(12) << it->second << setw(12) << m.ns_per_op()
+         << setprecision(2) << setw(9) << speedup << 'x'
+         << (slower ? "  REGRESSION" : "") << '\n';
+  }
+
+  return regression ? EXIT_FAILURE : EXIT_SUCCESS;
+}
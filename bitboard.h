@@ -0,0 +1,275 @@
+#ifndef BITBOARD_H_
+#define BITBOARD_H_
+
+#include "types.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Packed bitmask over the cells of a W x H board.
+ *
+ * Cells are stored column by column: column x occupies the lane of
+ * `LANE` bits starting at bit x * LANE, and bit 0 of a lane is the
+ * bottom cell of the column. Lanes are a power of two wide so that they
+ * never straddle two words, and their topmost bits are padding which is
+ * never set, so that shifting a word by one bit never moves a cell into
+ * a neighbouring column.
+ */
+template <size_t W, size_t H> class BasicBitBoard {
+public:
+  static constexpr size_t LANE = H < 16 ? 16 : H < 32 ? 32 : 64;
+  static constexpr size_t NB_BITS = W * LANE;
+  static constexpr size_t NB_WORDS = (NB_BITS + 63) / 64;
+  static constexpr uint64_t LANE_MASK = (uint64_t{1} << (LANE - 1) << 1) - 1;
+
+  static_assert(H < 64, "A column must fit in a single machine word");
+
+  constexpr BasicBitBoard() : m_words{} {}
+
+  /**
+   * Mask containing every cell of the board.
+   */
+  static BasicBitBoard full();
+
+  /**
+   * Mask containing every cell of the columns in [x_begin, x_end).
+   */
+  static constexpr BasicBitBoard columns(size_t x_begin, size_t x_end) {
+    BasicBitBoard ret;
+    for (size_t x = x_begin; x < x_end; ++x) {
+      for (size_t y = 0; y < H; ++y) {
+        const size_t b = x * LANE + y;
+        ret.m_words[b >> 6] |= uint64_t{1} << (b & 63);
+      }
+    }
+    return ret;
+  }
+
+  /**
+   * Bit position of the cell at index i = x + y * W, where y = 0 is the
+   * top row of the board.
+   */
+  static constexpr int bit_of(int i) {
+    const int x = i % W;
+    const int y = i / W;
+    return x * LANE + (H - 1 - y);
+  }
+
+  /**
+   * Inverse of #bit_of().
+   */
+  static constexpr int index_of(int b) {
+    const int x = b / LANE;
+    const int y = H - 1 - b % LANE;
+    return x + y * W;
+  }
+
+  bool test(int b) const { return m_words[b >> 6] >> (b & 63) & 1; }
+  void set(int b) { m_words[b >> 6] |= uint64_t{1} << (b & 63); }
+
+  bool any() const;
+  int count() const;
+
+  /**
+   * Position of the lowest set bit. The mask must be non-empty.
+   */
+  int lowest() const;
+
+  /**
+   * The bits of column x, bottom cell first.
+   */
+  uint64_t lane(size_t x) const;
+  void set_lane(size_t x, uint64_t bits);
+
+  /**
+   * Cells of the mask which have at least one neighbour in the mask.
+   */
+  BasicBitBoard connected() const;
+
+  /**
+   * Grow `seed` to the connected component of `within` which contains it.
+   */
+  static BasicBitBoard flood_fill(BasicBitBoard seed,
+                                  const BasicBitBoard &within);
+
+  /**
+   * Call `f(b)` for every set bit b, lowest first.
+   */
+  template <typename F> void for_each(F &&f) const;
+
+  BasicBitBoard &operator|=(const BasicBitBoard &o);
+  BasicBitBoard &operator&=(const BasicBitBoard &o);
+  BasicBitBoard &operator^=(const BasicBitBoard &o);
+  BasicBitBoard operator~() const;
+
+  bool operator==(const BasicBitBoard &o) const {
+    return m_words == o.m_words;
+  }
+  bool operator!=(const BasicBitBoard &o) const {
+    return m_words != o.m_words;
+  }
+
+  friend BasicBitBoard operator|(BasicBitBoard a, const BasicBitBoard &b) {
+    return a |= b;
+  }
+  friend BasicBitBoard operator&(BasicBitBoard a, const BasicBitBoard &b) {
+    return a &= b;
+  }
+  friend BasicBitBoard operator^(BasicBitBoard a, const BasicBitBoard &b) {
+    return a ^= b;
+  }
+
+private:
+  std::array<uint64_t, NB_WORDS> m_words;
+
+  BasicBitBoard shl(size_t n) const;
+  BasicBitBoard shr(size_t n) const;
+
+  /**
+   * All cells adjacent to a cell of the mask. May contain padding bits.
+   */
+  BasicBitBoard neighbours() const;
+};
+
+using BitBoard = BasicBitBoard<WIDTH, HEIGHT>;
+
+template <size_t W, size_t H>
+inline BasicBitBoard<W, H> BasicBitBoard<W, H>::full() {
+  static constexpr BasicBitBoard mask = columns(0, W);
+  return mask;
+}
+
+template <size_t W, size_t H>
+inline bool BasicBitBoard<W, H>::any() const {
+  uint64_t acc = 0;
+  for (auto w : m_words)
+    acc |= w;
+  return acc != 0;
+}
+
+template <size_t W, size_t H>
+inline int BasicBitBoard<W, H>::count() const {
+  int n = 0;
+  for (auto w : m_words)
+    n += __builtin_popcountll(w);
+  return n;
+}
+
+template <size_t W, size_t H>
+inline int BasicBitBoard<W, H>::lowest() const {
+  size_t k = 0;
+  while (m_words[k] == 0)
+    ++k;
+  return k * 64 + __builtin_ctzll(m_words[k]);
+}
+
+template <size_t W, size_t H>
+inline BasicBitBoard<W, H> &
+BasicBitBoard<W, H>::operator|=(const BasicBitBoard &o) {
+  for (size_t k = 0; k < NB_WORDS; ++k)
+    m_words[k] |= o.m_words[k];
+  return *this;
+}
+
+template <size_t W, size_t H>
+inline BasicBitBoard<W, H> &
+BasicBitBoard<W, H>::operator&=(const BasicBitBoard &o) {
+  for (size_t k = 0; k < NB_WORDS; ++k)
+    m_words[k] &= o.m_words[k];
+  return *this;
+}
+
+template <size_t W, size_t H>
+inline BasicBitBoard<W, H> &
+BasicBitBoard<W, H>::operator^=(const BasicBitBoard &o) {
+  for (size_t k = 0; k < NB_WORDS; ++k)
+    m_words[k] ^= o.m_words[k];
+  return *this;
+}
+
+template <size_t W, size_t H>
+inline BasicBitBoard<W, H> BasicBitBoard<W, H>::operator~() const {
+  BasicBitBoard ret;
+  for (size_t k = 0; k < NB_WORDS; ++k)
+    ret.m_words[k] = ~m_words[k];
+  return ret &= full();
+}
+
+template <size_t W, size_t H>
+inline uint64_t BasicBitBoard<W, H>::lane(size_t x) const {
+  const size_t b = x * LANE;
+  return m_words[b >> 6] >> (b & 63) & LANE_MASK;
+}
+
+template <size_t W, size_t H>
+inline void BasicBitBoard<W, H>::set_lane(size_t x, uint64_t bits) {
+  const size_t b = x * LANE;
+  uint64_t &w = m_words[b >> 6];
+  w = (w & ~(LANE_MASK << (b & 63))) | (bits << (b & 63));
+}
+
+template <size_t W, size_t H>
+inline BasicBitBoard<W, H> BasicBitBoard<W, H>::shl(size_t n) const {
+  BasicBitBoard ret;
+  const size_t q = n / 64;
+  const size_t r = n % 64;
+  for (size_t k = NB_WORDS; k-- > q;) {
+    ret.m_words[k] = m_words[k - q] << r;
+    if (r && k > q)
+      ret.m_words[k] |= m_words[k - q - 1] >> (64 - r);
+  }
+  return ret;
+}
+
+template <size_t W, size_t H>
+inline BasicBitBoard<W, H> BasicBitBoard<W, H>::shr(size_t n) const {
+  BasicBitBoard ret;
+  const size_t q = n / 64;
+  const size_t r = n % 64;
+  for (size_t k = 0; k + q < NB_WORDS; ++k) {
+    ret.m_words[k] = m_words[k + q] >> r;
+    if (r && k + q + 1 < NB_WORDS)
+      ret.m_words[k] |= m_words[k + q + 1] << (64 - r);
+  }
+  return ret;
+}
+
+template <size_t W, size_t H>
+inline BasicBitBoard<W, H> BasicBitBoard<W, H>::neighbours() const {
+  // Vertical neighbours never cross a word boundary, see #LANE.
+  BasicBitBoard ret = shl(LANE) | shr(LANE);
+  for (size_t k = 0; k < NB_WORDS; ++k)
+    ret.m_words[k] |= m_words[k] << 1 | m_words[k] >> 1;
+  return ret;
+}
+
+template <size_t W, size_t H>
+inline BasicBitBoard<W, H> BasicBitBoard<W, H>::connected() const {
+  return neighbours() & *this;
+}
+
+template <size_t W, size_t H>
+inline BasicBitBoard<W, H>
+BasicBitBoard<W, H>::flood_fill(BasicBitBoard seed,
+                                const BasicBitBoard &within) {
+  BasicBitBoard prev;
+  do {
+    prev = seed;
+    seed |= seed.neighbours() & within;
+  } while (seed != prev);
+  return seed;
+}
+
+template <size_t W, size_t H>
+template <typename F>
+inline void BasicBitBoard<W, H>::for_each(F &&f) const {
+  for (size_t k = 0; k < NB_WORDS; ++k) {
+    for (uint64_t w = m_words[k]; w; w &= w - 1) {
+      f(static_cast<int>(k * 64 + __builtin_ctzll(w)));
+    }
+  }
+}
+
+#endif // BITBOARD_H_
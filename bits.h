@@ -0,0 +1,67 @@
+#ifndef BITS_H_
+#define BITS_H_
+
+#include <cstdint>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+/**
+ * Bit manipulation helpers shared by the backends.
+ */
+namespace Bits {
+
+/**
+ * Gather the bits of `bits` selected by `mask` into the low bits of the
+ * result, preserving their order.
+ */
+inline uint64_t compress_generic(uint64_t bits, uint64_t mask) {
+  uint64_t ret = 0;
+  for (uint64_t out = 1; mask; mask &= mask - 1, out <<= 1) {
+    if (bits & mask & -mask) {
+      ret |= out;
+    }
+  }
+  return ret;
+}
+
+#if defined(__x86_64__) && not defined(__BMI2__)
+__attribute__((target("bmi2"))) inline uint64_t compress_bmi2(uint64_t bits,
+                                                              uint64_t mask) {
+  return _pext_u64(bits, mask);
+}
+
+// Checked once at startup, the binaries being built for any x86-64 CPU.
+inline const bool has_bmi2 = (__builtin_cpu_init(),
+                              __builtin_cpu_supports("bmi2"));
+#endif
+
+/**
+ * Same as #compress_generic(), with the PEXT instruction when the CPU
+ * supports it.
+ */
+inline uint64_t compress(uint64_t bits, uint64_t mask) {
+#if defined(__BMI2__)
+  return _pext_u64(bits, mask);
+#elif defined(__x86_64__)
+  return has_bmi2 ? compress_bmi2(bits, mask) : compress_generic(bits, mask);
+#else
+  return compress_generic(bits, mask);
+#endif
+}
+
+/**
+ * Word with the lowest bit of every field of `width` bits set.
+ */
+constexpr uint64_t field_lsbs(int width) {
+  uint64_t ret = 0;
+  for (int b = 0; b < 64; b += width) {
+    ret |= uint64_t{1} << b;
+  }
+  return ret;
+}
+
+} // namespace Bits
+
+#endif // BITS_H_
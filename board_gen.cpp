@@ -0,0 +1,61 @@
+#include "board_gen.h"
+#include "zobrist.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace {
+
+// Increment of the state of splitmix64 for each value of the stream.
+constexpr uint64_t GAMMA = 0x9e3779b97f4a7c15;
+
+} // namespace
+
+BoardGenerator::BoardGenerator(const BoardShape &shape, uint64_t seed,
+                               const std::vector<double> &weights)
+    : m_shape{shape}, m_seed{seed}, m_thresholds{} {
+  if (shape.width * shape.height > MAX_CELLS || shape.nb_colors < 1 ||
+      shape.nb_colors > MAX_COLORS) {
+    throw std::invalid_argument("Unsupported board shape for generation");
+  }
+
+  std::vector<double> w = weights;
+  if (w.empty()) {
+    w.assign(shape.nb_colors, 1.0);
+  }
+  const double sum = std::accumulate(w.begin(), w.end(), 0.0);
+  if (static_cast<int>(w.size()) != shape.nb_colors || not(sum > 0.0) ||
+      std::any_of(w.begin(), w.end(), [](double x) { return x < 0.0; })) {
+    throw std::invalid_argument(
+        "Expected a non-negative weight per color, with a positive sum");
+  }
+
+  // 2^64 as a double, the values of the stream being uniform below it.
+  const double range = std::ldexp(1.0, 64);
+  double cumulative = 0.0;
+  for (int c = 0; c + 1 < shape.nb_colors; ++c) {
+    cumulative += w[c] / sum;
+    const double threshold = std::floor(cumulative * range);
+    m_thresholds[c] = threshold >= range ? UINT64_MAX
+                                         : static_cast<uint64_t>(threshold);
+  }
+}
+
+void BoardGenerator::generate(uint64_t i, Color *cells) const {
+  const size_t n_cells = m_shape.width * m_shape.height;
+  const int last = m_shape.nb_colors - 1;
+
+  // Jump to the first value of the board, the state growing by GAMMA with
+  // each value.
+  uint64_t state = m_seed + i * n_cells * GAMMA;
+
+  for (size_t k = 0; k < n_cells; ++k) {
+    const uint64_t value = Zobrist::detail::splitmix64(state);
+    int c = 0;
+    while (c < last && value >= m_thresholds[c]) {
+      ++c;
+    }
+    cells[k] = static_cast<Color>(c + 1);
+  }
+}
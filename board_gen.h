@@ -0,0 +1,63 @@
+#ifndef BOARD_GEN_H_
+#define BOARD_GEN_H_
+
+#include "types.h"
+
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+/**
+ * Random boards drawn from a seed, the same on every platform.
+ *
+ * The seed stands for an endless sequence of boards, so that board i can be
+ * drawn on its own, in any order and from any thread. The cells of board i
+ * are drawn from the values i * W * H to (i + 1) * W * H - 1 of a splitmix64
+ * stream, as the Zobrist keys, each value picking a color with the
+ * probabilities given by the weights of the colors.
+ */
+class BoardGenerator {
+public:
+  /**
+   * Throws std::invalid_argument if the shape has more than #MAX_CELLS
+   * cells or #MAX_COLORS colors, or if the weights are not as many as the
+   * colors or do not have a positive sum.
+   *
+   * @Param shape  The shape of the boards, which use all of its colors.
+   * @Param seed  The seed of the sequence of boards.
+   * @Param weights  The relative frequencies of the colors, uniform if
+   *                 empty.
+   */
+  BoardGenerator(const BoardShape &shape, uint64_t seed,
+                 const std::vector<double> &weights = {});
+
+  /**
+   * Draw the width * height cells of board i of the sequence.
+   */
+  void generate(uint64_t i, Color *cells) const;
+
+  /**
+   * Same as above, throwing std::invalid_argument if the boards do not
+   * have N cells.
+   */
+  template <size_t N>
+  void generate(uint64_t i, std::array<Color, N> &board) const {
+    if (N != m_shape.width * m_shape.height) {
+      throw std::invalid_argument("Boards do not match the generator shape");
+    }
+    generate(i, board.data());
+  }
+
+  const BoardShape &shape() const { return m_shape; }
+
+private:
+  BoardShape m_shape;
+  uint64_t m_seed;
+
+  // A value of the stream below m_thresholds[c - 1] but not the previous
+  // thresholds picks color c, the last color taking the values left.
+  std::array<uint64_t, MAX_COLORS> m_thresholds;
+};
+
+#endif // BOARD_GEN_H_
@@ -0,0 +1,301 @@
+#include "board_io.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <fstream>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+
+namespace {
+
+constexpr char MAGIC[4] = {'S', 'G', 'B', '1'};
+
+inline bool is_space(int c) {
+  return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+/**
+ * Read the cells of a board from `next()`, which returns the next character
+ * or -1 at the end of the input. The character following a cell is consumed.
+ */
+template <typename Next>
+bool parse_cells(Next &&next, Color *cells, size_t n_cells, int nb_colors) {
+  for (Color *cell = cells; cell != cells + n_cells; ++cell) {
+    int c = next();
+    while (is_space(c)) {
+      c = next();
+    }
+
+    if (c == '-') {
+      // The only negative value is the empty cell.
+      if (next() != '1') {
+        return false;
+      }
+      *cell = Color::Empty;
+      c = next();
+    } else {
+      int value = 0;
+      int n_digits = 0;
+      for (; c >= '0' && c <= '9' && value < nb_colors; c = next()) {
+        value = value * 10 + (c - '0');
+        ++n_digits;
+      }
+      if (n_digits == 0 || value >= nb_colors) {
+        return false;
+      }
+      *cell = Color(value + 1);
+    }
+
+    if (c != -1 && not is_space(c)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace
+
+const char *BoardIO::parse(const char *first, const char *last, Color *cells,
+                           size_t n_cells, int nb_colors) {
+  auto next = [&]() -> int {
+    return first == last ? -1 : static_cast<unsigned char>(*first++);
+  };
+  return parse_cells(next, cells, n_cells, nb_colors) ? first : nullptr;
+}
+
+bool BoardIO::read(std::istream &is, Color *cells, size_t n_cells,
+                   int nb_colors) {
+  std::istream::sentry sentry{is, true};
+  if (not sentry) {
+    return false;
+  }
+
+  std::streambuf &buf = *is.rdbuf();
+  bool eof = false;
+  auto next = [&]() -> int {
+    const auto c = buf.sbumpc();
+    if (std::char_traits<char>::eq_int_type(c, std::char_traits<char>::eof())) {
+      eof = true;
+      return -1;
+    }
+    return std::char_traits<char>::to_int_type(c);
+  };
+
+  if (not parse_cells(next, cells, n_cells, nb_colors)) {
+    is.setstate(std::ios::failbit);
+    return false;
+  }
+  if (eof) {
+    is.setstate(std::ios::eofbit);
+  }
+  return true;
+}
+
+void BoardIO::write(std::ostream &os, const Color *cells, size_t width,
+                    size_t height) {
+  std::ostream::sentry sentry{os};
+  if (not sentry) {
+    return;
+  }
+
+  // The colors fit on a single digit.
+  static_assert(MAX_COLORS <= 10);
+
+  std::streambuf &buf = *os.rdbuf();
+  bool ok = true;
+  auto put = [&](char c) {
+    ok = ok && not std::char_traits<char>::eq_int_type(
+                   buf.sputc(c), std::char_traits<char>::eof());
+  };
+
+  for (size_t y = 0; y < height; ++y) {
+    for (size_t x = 0; x < width; ++x) {
+      if (x > 0) {
+        put(' ');
+      }
+      const Color c = cells[x + y * width];
+      if (c == Color::Empty) {
+        put('-');
+        put('1');
+      } else {
+        put(static_cast<char>('0' + static_cast<int>(c) - 1));
+      }
+    }
+    put('\n');
+  }
+
+  if (not ok) {
+    os.setstate(std::ios::badbit);
+  }
+}
+
+bool BoardIO::shape(const char *first, const char *last, BoardShape &shape) {
+  shape = BoardShape{0, 0, 0};
+
+  // Skip the whitespace before the board.
+  while (first != last && is_space(*first)) {
+    ++first;
+  }
+
+  while (first != last) {
+    const char *eol = std::find(first, last, '\n');
+
+    size_t n_cells = 0;
+    for (const char *p = first; p != eol;) {
+      if (is_space(*p)) {
+        ++p;
+        continue;
+      }
+      const char *end = std::find_if(p, eol, is_space);
+      int value = 0;
+      const auto [ptr, ec] = std::from_chars(p, end, value);
+      if (ec != std::errc{} || ptr != end || value < -1 ||
+          value >= MAX_COLORS) {
+        return false;
+      }
+      shape.nb_colors = std::max(shape.nb_colors, value + 1);
+      ++n_cells;
+      p = end;
+    }
+
+    if (n_cells == 0) {
+      break; // Blank line
+    }
+    if (shape.height > 0 && n_cells != shape.width) {
+      return false;
+    }
+    shape.width = n_cells;
+    ++shape.height;
+
+    first = eol == last ? last : eol + 1;
+  }
+
+  return shape.height > 0;
+}
+
+BoardCorpus::BoardCorpus(const std::string &path)
+    : m_data{nullptr}, m_length{0}, m_size{0}, m_shape{0, 0, 0},
+      m_board_size{0} {
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error("Failed to open corpus " + path);
+  }
+
+  struct stat st;
+  if (::fstat(fd, &st) != 0 || st.st_size < HEADER_SIZE) {
+    ::close(fd);
+    throw std::runtime_error("Truncated corpus " + path);
+  }
+  m_length = st.st_size;
+
+  void *data = ::mmap(nullptr, m_length, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (data == MAP_FAILED) {
+    throw std::runtime_error("Failed to map corpus " + path);
+  }
+  m_data = static_cast<const uint8_t *>(data);
+
+  uint64_t size = 0;
+  for (int k = 7; k >= 0; --k) {
+    size = size << 8 | m_data[8 + k];
+  }
+
+  m_shape = BoardShape{m_data[4], m_data[5], m_data[6]};
+  m_board_size = (m_shape.width * m_shape.height * 3 + 7) / 8;
+
+  if (std::memcmp(m_data, MAGIC, sizeof(MAGIC)) != 0 ||
+      m_shape.width * m_shape.height == 0 ||
+      m_shape.width * m_shape.height > MAX_CELLS ||
+      m_shape.nb_colors > MAX_COLORS ||
+      size > (m_length - HEADER_SIZE) / m_board_size) {
+    ::munmap(const_cast<uint8_t *>(m_data), m_length);
+    throw std::runtime_error("Invalid corpus header in " + path);
+  }
+  m_size = size;
+}
+
+BoardCorpus::~BoardCorpus() {
+  ::munmap(const_cast<uint8_t *>(m_data), m_length);
+}
+
+void BoardCorpus::check_cells(size_t n_cells) const {
+  if (n_cells != m_shape.width * m_shape.height) {
+    throw std::invalid_argument("Boards do not match the corpus shape");
+  }
+}
+
+void BoardCorpus::get(size_t i, Color *cells) const {
+  const uint8_t *p = m_data + HEADER_SIZE + i * m_board_size;
+
+  uint32_t bits = 0;
+  int n_bits = 0;
+  for (Color *cell = cells, *end = cells + m_shape.width * m_shape.height;
+       cell != end; ++cell) {
+    if (n_bits < 3) {
+      bits |= uint32_t{*p++} << n_bits;
+      n_bits += 8;
+    }
+    const uint8_t value = bits & 7;
+    bits >>= 3;
+    n_bits -= 3;
+
+    if (value > m_shape.nb_colors) {
+      throw std::runtime_error("Invalid cell in corpus");
+    }
+    *cell = Color(value);
+  }
+}
+
+bool BoardCorpus::is_corpus(const std::string &path) {
+  std::ifstream ifs{path, std::ios::binary};
+  char magic[sizeof(MAGIC)] = {};
+  ifs.read(magic, sizeof(magic));
+  return ifs && std::memcmp(magic, MAGIC, sizeof(MAGIC)) == 0;
+}
+
+void BoardCorpus::write(const std::string &path, const BoardShape &shape,
+                        const Color *cells, size_t n_boards) {
+  const size_t n_cells = shape.width * shape.height;
+  if (n_cells == 0 || n_cells > MAX_CELLS || shape.nb_colors > MAX_COLORS) {
+    throw std::invalid_argument("Invalid corpus shape");
+  }
+
+  std::ofstream ofs{path, std::ios::binary};
+
+  uint8_t header[HEADER_SIZE] = {};
+  std::memcpy(header, MAGIC, sizeof(MAGIC));
+  header[4] = shape.width;
+  header[5] = shape.height;
+  header[6] = shape.nb_colors;
+  for (int k = 0; k < 8; ++k) {
+    header[8 + k] = uint64_t{n_boards} >> (8 * k) & 0xff;
+  }
+  ofs.write(reinterpret_cast<const char *>(header), sizeof(header));
+
+  uint8_t packed[(MAX_CELLS * 3 + 7) / 8];
+  const size_t board_size = (n_cells * 3 + 7) / 8;
+
+  for (size_t i = 0; i < n_boards; ++i, cells += n_cells) {
+    std::fill(packed, packed + board_size, 0);
+    for (size_t k = 0; k < n_cells; ++k) {
+      const uint32_t value = static_cast<uint8_t>(cells[k]);
+      const size_t b = 3 * k;
+      packed[b >> 3] |= value << (b & 7);
+      if ((b & 7) > 5) {
+        packed[(b >> 3) + 1] |= value >> (8 - (b & 7));
+      }
+    }
+    ofs.write(reinterpret_cast<const char *>(packed), board_size);
+  }
+
+  if (not ofs.flush()) {
+    throw std::runtime_error("Failed to write corpus " + path);
+  }
+}
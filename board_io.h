@@ -0,0 +1,155 @@
+#ifndef BOARD_IO_H_
+#define BOARD_IO_H_
+
+#include "types.h"
+
+#include <array>
+#include <cstdint>
+#include <iosfwd>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/**
+ * Readers and writer of the text format of the boards: width * height
+ * integers separated by whitespace, row by row from the top, where -1 is an
+ * empty cell and 0 to nb_colors - 1 are the colors.
+ *
+ * None of the functions allocates.
+ */
+namespace BoardIO {
+
+/**
+ * Parse the `n_cells` cells of a board from the characters in
+ * [first, last).
+ *
+ * @Return A pointer past the last cell read, or nullptr if the range does
+ * not start with a valid board.
+ */
+const char *parse(const char *first, const char *last, Color *cells,
+                  size_t n_cells, int nb_colors);
+
+template <size_t N>
+const char *parse(const char *first, const char *last,
+                  std::array<Color, N> &board, int nb_colors = NB_COLORS) {
+  return parse(first, last, board.data(), N, nb_colors);
+}
+
+/**
+ * Read the `n_cells` cells of a board from a stream, reading its buffer
+ * directly. The failbit of the stream is set if it does not hold a valid
+ * board.
+ */
+bool read(std::istream &is, Color *cells, size_t n_cells, int nb_colors);
+
+template <size_t N>
+bool read(std::istream &is, std::array<Color, N> &board,
+          int nb_colors = NB_COLORS) {
+  return read(is, board.data(), N, nb_colors);
+}
+
+/**
+ * Guess the shape of the first board in [first, last) from its layout:
+ * the width is the number of cells of the first row, the height the number
+ * of rows up to the first blank line, and the number of colors the highest
+ * one used.
+ *
+ * @Return false if the range does not start with a rectangular board.
+ */
+bool shape(const char *first, const char *last, BoardShape &shape);
+
+/**
+ * Write a board of width * height cells to a stream, one row per line,
+ * writing its buffer directly. The badbit of the stream is set if the
+ * board cannot be written.
+ *
+ * Boards written one after the other should be separated by a blank line,
+ * for shape() to find the height of the first one.
+ */
+void write(std::ostream &os, const Color *cells, size_t width, size_t height);
+
+template <size_t N>
+void write(std::ostream &os, const std::array<Color, N> &board, size_t width,
+           size_t height) {
+  if (N != width * height) {
+    throw std::invalid_argument("Boards do not match the given shape");
+  }
+  write(os, board.data(), width, height);
+}
+
+} // namespace BoardIO
+
+/**
+ * Memory-mapped binary corpus of boards of the same shape.
+ *
+ * The file starts with a 16 bytes header: the magic "SGB1", the width, the
+ * height and the number of colors of the boards as one byte each, a zero
+ * byte, then the number of boards as a little-endian 64 bits integer.
+ * Each board follows on (width * height * 3 + 7) / 8 bytes, its cells
+ * packed on 3 bits each in index order, least significant bits first, the
+ * value of a cell being its Color.
+ */
+class BoardCorpus {
+public:
+  static constexpr size_t HEADER_SIZE = 16;
+
+  /**
+   * Map the corpus at `path`. Throws std::runtime_error if the file cannot
+   * be mapped or if its header is invalid.
+   */
+  explicit BoardCorpus(const std::string &path);
+  ~BoardCorpus();
+
+  BoardCorpus(const BoardCorpus &) = delete;
+  BoardCorpus &operator=(const BoardCorpus &) = delete;
+
+  size_t size() const { return m_size; }
+  const BoardShape &shape() const { return m_shape; }
+
+  /**
+   * Unpack the width * height cells of the board at index i.
+   */
+  void get(size_t i, Color *cells) const;
+
+  /**
+   * Same as above, throwing std::invalid_argument if the boards of the
+   * corpus do not have N cells.
+   */
+  template <size_t N> void get(size_t i, std::array<Color, N> &board) const {
+    check_cells(N);
+    get(i, board.data());
+  }
+
+  /**
+   * Check whether the file at `path` starts with the magic of a corpus.
+   */
+  static bool is_corpus(const std::string &path);
+
+  /**
+   * Write a corpus of `n_boards` boards of the given shape to `path`, their
+   * cells following each other in `cells`.
+   */
+  static void write(const std::string &path, const BoardShape &shape,
+                    const Color *cells, size_t n_boards);
+
+  template <size_t N>
+  static void write(const std::string &path, const BoardShape &shape,
+                    const std::vector<std::array<Color, N>> &boards) {
+    if (N != shape.width * shape.height) {
+      throw std::invalid_argument("Boards do not match the corpus shape");
+    }
+    write(path, shape, boards.empty() ? nullptr : boards.front().data(),
+          boards.size());
+  }
+
+private:
+  const uint8_t *m_data;
+  size_t m_length;
+  size_t m_size;
+  BoardShape m_shape;
+  size_t m_board_size;
+
+  void check_cells(size_t n_cells) const;
+};
+
+#endif // BOARD_IO_H_
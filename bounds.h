@@ -0,0 +1,83 @@
+#ifndef BOUNDS_H_
+#define BOUNDS_H_
+
+#include "types.h"
+#include "samegame.h"
+
+#include <array>
+
+/**
+ * Upper bounds on the score which can still be collected from a position,
+ * so that the searches can cut the branches which cannot beat the best
+ * sequence they found.
+ *
+ * They only look at the number of cells of each color. Removing the n cells
+ * of a color in groups never scores more than removing them all at once,
+ * as (a - 2)^2 + (b - 2)^2 < (a + b - 2)^2 for a, b >= 2. And the board can
+ * only be cleared if no color is down to a single cell, since that cell can
+ * never be removed.
+ */
+namespace Bounds {
+
+// Bonus for clearing the board, see BasicSameGame::score_of().
+constexpr double CLEAR_BONUS = 1000.0;
+
+/**
+ * Best score collected by removing `n` cells of the same color.
+ */
+constexpr double color_bound(int n) { return n > 2 ? (n - 2) * (n - 2) : 0.0; }
+
+/**
+ * Whether the board with the given color counts, indexed as in
+ * BasicSameGame::colour_counter(), may still be cleared.
+ */
+template <size_t N> bool can_clear(const std::array<int, N> &ccount) {
+  bool any_cell = false;
+  for (size_t c = 1; c < N; ++c) {
+    if (ccount[c] == 1) {
+      return false;
+    }
+    any_cell |= ccount[c] > 0;
+  }
+  return any_cell;
+}
+
+/**
+ * Upper bound on the score collected from a board with the given color
+ * counts.
+ */
+template <size_t N> double upper_bound(const std::array<int, N> &ccount) {
+  double ret = can_clear(ccount) ? CLEAR_BONUS : 0.0;
+  for (size_t c = 1; c < N; ++c) {
+    ret += color_bound(ccount[c]);
+  }
+  return ret;
+}
+
+template <typename Game> bool can_clear(const Game &sg) {
+  std::array<int, Game::nb_colors() + 1> ccount;
+  sg.colour_counter(ccount.begin());
+  return can_clear(ccount);
+}
+
+template <typename Game> double upper_bound(const Game &sg) {
+  std::array<int, Game::nb_colors() + 1> ccount;
+  sg.colour_counter(ccount.begin());
+  return upper_bound(ccount);
+}
+
+/**
+ * Upper bound on the score collected after playing a move of `sg`, not
+ * counting the move itself. The move is not applied.
+ */
+template <typename Game> double upper_bound(const Game &sg, const Move &move) {
+  std::array<int, Game::nb_colors() + 1> ccount;
+  sg.colour_counter(ccount.begin());
+  ccount[static_cast<std::underlying_type_t<Color>>(move.color)] -= move.size;
+  ccount[0] += move.size;
+  return upper_bound(ccount);
+}
+
+} // namespace Bounds
+
+#endif // BOUNDS_H_
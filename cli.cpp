@@ -0,0 +1,22 @@
+#include "cli.h"
+
+#include <glob.h>
+
+double Cli::parse_double(const std::string &s) {
+  size_t pos = 0;
+  const double value = std::stod(s, &pos);
+  if (pos != s.size()) {
+    throw std::invalid_argument{"Invalid number " + s};
+  }
+  return value;
+}
+
+std::vector<std::string> Cli::glob_files(const std::string &pattern) {
+  std::vector<std::string> ret;
+  glob_t g;
+  if (glob(pattern.c_str(), 0, nullptr, &g) == 0) {
+    ret.assign(g.gl_pathv, g.gl_pathv + g.gl_pathc);
+  }
+  globfree(&g);
+  return ret;
+}
@@ -0,0 +1,46 @@
+#ifndef CLI_H_
+#define CLI_H_
+
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/**
+ * Helpers shared by the command line tools.
+ */
+namespace Cli {
+
+/**
+ * Parse a whole argument as a non-negative integer of type T. Throws
+ * std::invalid_argument or std::out_of_range otherwise.
+ */
+template <typename T> T parse_unsigned(const std::string &s) {
+  // stoull() would wrap a negative value around.
+  if (s.find('-') != std::string::npos) {
+    throw std::out_of_range{"Negative value " + s};
+  }
+  size_t pos = 0;
+  const unsigned long long value = std::stoull(s, &pos);
+  if (pos != s.size()) {
+    throw std::invalid_argument{"Invalid integer " + s};
+  }
+  if (value > static_cast<unsigned long long>(std::numeric_limits<T>::max())) {
+    throw std::out_of_range{"Too large value " + s};
+  }
+  return static_cast<T>(value);
+}
+
+/**
+ * Same as above for a floating-point argument, of any sign.
+ */
+double parse_double(const std::string &s);
+
+/**
+ * Paths matching a glob pattern, in alphabetical order.
+ */
+std::vector<std::string> glob_files(const std::string &pattern);
+
+} // namespace Cli
+
+#endif // CLI_H_
@@ -0,0 +1,208 @@
+#include "daemon.h"
+#include "board_io.h"
+
+#include <chrono>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <vector>
+
+namespace {
+
+// Whether only whitespace is left on the line.
+bool at_end(std::istream &args) {
+  args >> std::ws;
+  return args.eof();
+}
+
+} // namespace
+
+Daemon::Daemon(const TimeControl &time, unsigned seed, SolutionCache *cache)
+    : m_time{time}, m_cache{cache}, m_policy{time, 3, seed},
+      m_game{WIDTH, HEIGHT}, m_has_game{false}, m_record{}, m_cancel{false},
+      m_searching{false}, m_ponder{true}, m_ponder_requested{false},
+      m_quit{false} {
+  m_thread = std::thread{[this] { ponder(); }};
+}
+
+Daemon::~Daemon() {
+  {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    m_quit = true;
+    m_cancel = true;
+  }
+  m_cv.notify_all();
+  m_thread.join();
+}
+
+void Daemon::ponder() {
+  std::unique_lock<std::mutex> lock{m_mutex};
+  while (true) {
+    m_cv.wait(lock, [this] { return m_quit || m_ponder_requested; });
+    if (m_quit) {
+      return;
+    }
+
+    m_ponder_requested = false;
+    m_searching = true;
+    lock.unlock();
+
+    // Only a pause stops the search, unless the game is over.
+    m_policy.search(m_game, Deadline{Deadline::Clock::time_point::max(),
+                                     &m_cancel});
+
+    lock.lock();
+    m_searching = false;
+    m_cv.notify_all();
+  }
+}
+
+void Daemon::pause() {
+  std::unique_lock<std::mutex> lock{m_mutex};
+  m_ponder_requested = false;
+  m_cancel = true;
+  m_cv.wait(lock, [this] { return not m_searching; });
+}
+
+void Daemon::resume() {
+  {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    if (not m_ponder || not m_has_game) {
+      return;
+    }
+    m_cancel = false;
+    m_ponder_requested = true;
+  }
+  m_cv.notify_all();
+}
+
+void Daemon::run(std::istream &is, std::ostream &os) {
+  for (std::string line; std::getline(is, line);) {
+    std::istringstream args{line};
+    std::string command;
+    if (not(args >> command)) {
+      continue;
+    }
+    if (command == "quit") {
+      break;
+    }
+
+    pause();
+    handle(command, args, os);
+    os << std::flush;
+    resume();
+  }
+  pause();
+}
+
+void Daemon::handle(const std::string &command, std::istream &args,
+                    std::ostream &os) {
+  if (command == "ponder") {
+    std::string value;
+    args >> value;
+    if ((value != "on" && value != "off") || not at_end(args)) {
+      os << "error ponder takes on or off\n";
+      return;
+    }
+    m_ponder = value == "on";
+    os << "ok\n";
+    return;
+  }
+
+  if (command == "board") {
+    const std::string cells{std::istreambuf_iterator<char>{args}, {}};
+    Board board;
+    if (not BoardIO::parse(cells.data(), cells.data() + cells.size(),
+                           board)) {
+      os << "error invalid board\n";
+      return;
+    }
+    m_game.load(board);
+    m_has_game = true;
+    m_record = GameRecord{};
+    m_record.board_hash = m_game.hash();
+
+    std::vector<Action> line;
+    double score;
+    if (m_cache && m_cache->lookup(m_game, line, score)) {
+      m_policy.set_incumbent(m_game, score, line);
+    }
+    os << "ok\n";
+    return;
+  }
+
+  if (not m_has_game) {
+    os << "error no board\n";
+    return;
+  }
+
+  if (command == "play") {
+    int cell = -1;
+    if (not(args >> cell) || not at_end(args) || cell < 0 ||
+        cell >= static_cast<int>(WIDTH * HEIGHT)) {
+      os << "error invalid cell\n";
+      return;
+    }
+    const Action action{m_game.get_cluster(cell).rep};
+    if (not m_game.is_valid(action)) {
+      os << "error invalid move\n";
+      return;
+    }
+    os << "ok " << apply(action) << '\n';
+    return;
+  }
+
+  if (command == "move") {
+    // Without a time, the time per move.
+    long ms = -1;
+    if (not at_end(args) && (not(args >> ms) || not at_end(args) || ms < 0)) {
+      os << "error invalid time\n";
+      return;
+    }
+    const Deadline deadline =
+        ms >= 0 ? Deadline::in(std::chrono::milliseconds{ms})
+                : Deadline::in(m_time.per_move);
+
+    const auto [okay, action] = m_policy.play(m_game, deadline);
+    if (not okay) {
+      os << "move none\n";
+      return;
+    }
+    const double score = apply(action);
+    os << "move " << action.index << ' ' << score << '\n';
+    return;
+  }
+
+  if (command == "line") {
+    if (not at_end(args)) {
+      os << "error line takes no argument\n";
+      return;
+    }
+    // A deadline already expired only sets up the best line.
+    const PolicyAnytime::Sequence &best =
+        m_policy.search(m_game, Deadline::in(Deadline::Clock::duration{0}));
+    os << "line " << best.score;
+    for (const Action &action : best.moves) {
+      os << ' ' << action.index;
+    }
+    os << '\n';
+    return;
+  }
+
+  os << "error unknown command " << command << '\n';
+}
+
+double Daemon::apply(const Action &action) {
+  const double score = m_game.score(action);
+  m_record.moves.push_back(Records::encode_move(m_game, action));
+  m_record.score += score;
+  // Keeps the best line of the search when it starts with this move. After
+  // a search move, the policy has already played it and ignores the call.
+  m_policy.advance(m_game, action);
+  m_game.apply(action);
+
+  if (m_cache && m_game.clusters().empty()) {
+    m_cache->store(m_record);
+  }
+  return score;
+}
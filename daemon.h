@@ -0,0 +1,106 @@
+#ifndef DAEMON_H_
+#define DAEMON_H_
+
+#include "anytime.h"
+#include "game_record.h"
+#include "samegame.h"
+#include "solution_cache.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <iosfwd>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/**
+ * Long-running solver answering requests on a stream, one per line, which
+ * keeps its searches warm from one request to the next and thinks about the
+ * current position while it waits for the next one.
+ *
+ * The requests, and their answers on a single line:
+ *
+ *     board CELLS   Start a game from the board whose cells are given as in
+ *                   the board files, row by row from the top.
+ *                   -> ok
+ *     play CELL     Play the cluster of a cell.
+ *                   -> ok SCORE
+ *     move [MS]     Search for at most MS milliseconds, or the time per
+ *                   move, then play the best move.
+ *                   -> move CELL SCORE, or move none once the game is over
+ *     line          -> line SCORE CELL...  The best line known from the
+ *                   current position.
+ *     ponder on|off Whether to search while waiting, on by default.
+ *                   -> ok
+ *     quit          Stop.
+ *
+ * An invalid request is answered with "error MESSAGE".
+ *
+ * The searches are those of a #PolicyAnytime, whose best line is kept
+ * between the requests on the same game. With a #SolutionCache, the games
+ * start from the best lines known for their board, and the finished games
+ * which beat them are stored back.
+ */
+class Daemon {
+public:
+  Daemon(const TimeControl &time, unsigned seed,
+         SolutionCache *cache = nullptr);
+  ~Daemon();
+
+  Daemon(const Daemon &) = delete;
+  Daemon &operator=(const Daemon &) = delete;
+
+  /**
+   * Answer the requests of `is` on `os` until "quit" or the end of `is`.
+   */
+  void run(std::istream &is, std::ostream &os);
+
+private:
+  TimeControl m_time;
+  SolutionCache *m_cache;
+
+  PolicyAnytime m_policy;
+  SameGame m_game;
+  bool m_has_game;
+  // Moves played since the board was loaded, for the cache.
+  GameRecord m_record;
+
+  // The background search holds `m_mutex` while it sets `m_searching`, and
+  // stops once `m_cancel` is set.
+  std::thread m_thread;
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  std::atomic<bool> m_cancel;
+  bool m_searching;
+  bool m_ponder;
+  bool m_ponder_requested;
+  bool m_quit;
+
+  /**
+   * Body of the background thread.
+   */
+  void ponder();
+
+  /**
+   * Stop the background search, which leaves the game to the caller.
+   */
+  void pause();
+
+  /**
+   * Search the current position in the background, until the next pause.
+   */
+  void resume();
+
+  /**
+   * Answer a request other than "quit".
+   */
+  void handle(const std::string &command, std::istream &args,
+              std::ostream &os);
+
+  /**
+   * Play a valid action, storing the game in the cache once it is over.
+   */
+  double apply(const Action &action);
+};
+
+#endif // DAEMON_H_
@@ -0,0 +1,82 @@
+#ifndef DEADLINE_H_
+#define DEADLINE_H_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+
+/**
+ * A point in time on the monotonic clock, after which a search must return
+ * the best result it has found.
+ *
+ * The default deadline never expires, and checking it does not read the
+ * clock, so that the searches without a time limit do not pay for it. A
+ * deadline may also be cancelled from another thread through a flag.
+ */
+class Deadline {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  Deadline() : m_time{Clock::time_point::max()}, m_cancel{nullptr} {}
+  explicit Deadline(Clock::time_point time) : m_time{time}, m_cancel{nullptr} {}
+
+  /**
+   * A deadline which also expires as soon as `*cancel` is set.
+   */
+  Deadline(Clock::time_point time, const std::atomic<bool> *cancel)
+      : m_time{time}, m_cancel{cancel} {}
+
+  /**
+   * The deadline `duration` from now, which never expires if `duration`
+   * goes past the end of the clock.
+   */
+  static Deadline in(Clock::duration duration) {
+    const Clock::time_point now = Clock::now();
+    if (duration >= Clock::time_point::max() - now) {
+      return Deadline{};
+    }
+    return Deadline{now + std::max(duration, Clock::duration::zero())};
+  }
+
+  bool never() const {
+    return m_time == Clock::time_point::max() && not m_cancel;
+  }
+
+  bool expired() const {
+    if (m_cancel && m_cancel->load(std::memory_order_relaxed)) {
+      return true;
+    }
+    return m_time != Clock::time_point::max() && Clock::now() >= m_time;
+  }
+
+  /**
+   * Time left until the deadline, zero once it expired, not counting a
+   * cancellation to come.
+   */
+  Clock::duration remaining() const {
+    if (m_time == Clock::time_point::max()) {
+      return Clock::duration::max();
+    }
+    return std::max(m_time - Clock::now(), Clock::duration::zero());
+  }
+
+  Clock::time_point time() const { return m_time; }
+
+  /**
+   * The earliest of two deadlines, cancelled along with either of them if
+   * only one has a flag.
+   */
+  friend Deadline min(const Deadline &a, const Deadline &b) {
+    Deadline ret = a.m_time < b.m_time ? a : b;
+    if (not ret.m_cancel) {
+      ret.m_cancel = a.m_cancel ? a.m_cancel : b.m_cancel;
+    }
+    return ret;
+  }
+
+private:
+  Clock::time_point m_time;
+  const std::atomic<bool> *m_cancel;
+};
+
+#endif // DEADLINE_H_
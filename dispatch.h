@@ -0,0 +1,46 @@
+#ifndef DISPATCH_H_
+#define DISPATCH_H_
+
+#include "types.h"
+#include "samegame.h"
+
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+/**
+ * Tag standing for a game type, passed to the callables of dispatch().
+ */
+template <typename Game> struct GameTag {
+  using type = Game;
+};
+
+/**
+ * Call `f(GameTag<Game>{})`, where Game is the first instantiation of
+ * #BasicSameGame in #SameGames with the dimensions of `shape` and at least
+ * `shape.nb_colors` colors.
+ *
+ * `f` must return the same type for every game. Throws
+ * std::invalid_argument if no instantiation fits.
+ */
+template <size_t I = 0, typename F>
+std::invoke_result_t<F, GameTag<std::tuple_element_t<0, SameGames>>>
+dispatch(const BoardShape &shape, F &&f) {
+  if constexpr (I == std::tuple_size_v<SameGames>) {
+    throw std::invalid_argument("Unsupported board shape " +
+                                std::to_string(shape.width) + "x" +
+                                std::to_string(shape.height) + " with " +
+                                std::to_string(shape.nb_colors) + " colors");
+  } else {
+    using Game = std::tuple_element_t<I, SameGames>;
+    if (Game::width() == shape.width && Game::height() == shape.height &&
+        Game::nb_colors() >= shape.nb_colors) {
+      return std::forward<F>(f)(GameTag<Game>{});
+    }
+    return dispatch<I + 1>(shape, std::forward<F>(f));
+  }
+}
+
+#endif // DISPATCH_H_
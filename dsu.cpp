@@ -1,48 +1,79 @@
 #include "dsu.h"
+#include "stats.h"
 
 #include <algorithm>
 #include <numeric>
+#include <utility>
 
-DSU::DSU(size_t size) : m_clusters{} {
-  for (auto i = 0; i < size; ++i) {
-    Cluster &cluster = m_clusters.emplace_back(i);
-    cluster.members = std::vector<int>(1, i);
-    cluster.members.reserve(size);
-  }
+template <size_t N> BasicDSU<N>::BasicDSU() {
+  m_colors.fill(Color::Empty);
+  reset();
+}
+
+template <size_t N> void BasicDSU<N>::reset() {
+  std::iota(m_parents.begin(), m_parents.end(), 0);
+  std::iota(m_next.begin(), m_next.end(), 0);
+  std::iota(m_last.begin(), m_last.end(), 0);
+  m_sizes.fill(1);
 }
 
-void DSU::reset() {
-  std::for_each(m_clusters.begin(), m_clusters.end(),
-                [n = 0](Cluster &c) mutable {
-                  c.rep = n++;
-                  c.members.clear();
-                  c.members.push_back(c.rep);
-                });
+template <size_t N> void BasicDSU<N>::reset(int i) {
+  m_parents[i] = i;
+  m_next[i] = i;
+  m_last[i] = i;
+  m_sizes[i] = 1;
 }
 
-int DSU::find_rep(int i) const {
-  if (int &rep = m_clusters[i].rep; rep != i) {
-    return rep = find_rep(rep);
+template <size_t N> int BasicDSU<N>::find_rep(int i) const {
+  int rep = i;
+  [[maybe_unused]] int depth = 0;
+  for (; m_parents[rep] != rep; ++depth) {
+    rep = m_parents[rep];
+  }
+  SG_STATS_RECORD(FindDepth, depth);
+
+  // Compress the path, so that its cells point straight to the
+  // representative.
+  while (m_parents[i] != rep) {
+    i = std::exchange(m_parents[i], rep);
   }
-  return i;
+  return rep;
 }
 
-void DSU::unite(int a, int b) {
+// NOTE: The members of a cluster form a cycle through `m_next`, with the last
+// member pointing back to the first. Swapping the links out of the last
+// members of two cycles thus joins them into a single one, the members of the
+// second cluster coming after those of the first.
+template <size_t N> void BasicDSU<N>::unite(int a, int b) {
   a = find_rep(a);
   b = find_rep(b);
 
   if (a != b) {
-    if (m_clusters[a].size() < m_clusters[b].size()) {
+    // The smallest index is kept as representative, so that it only depends
+    // on the cluster and not on the order in which it was formed.
+    if (b < a) {
       std::swap(a, b);
     }
-    merge_clusters(m_clusters[a], m_clusters[b]);
+    // Still list the members of the larger cluster first.
+    Link first = a;
+    Link second = b;
+    if (m_sizes[a] < m_sizes[b]) {
+      std::swap(first, second);
+    }
+    std::swap(m_next[m_last[first]], m_next[m_last[second]]);
+
+    m_last[a] = m_last[second];
+    m_sizes[a] += m_sizes[b];
+    m_parents[b] = a;
   }
+  SG_STATS_RECORD(Unite, m_sizes[a]);
 }
 
-void DSU::merge_clusters(Cluster &a, Cluster &b) {
-  b.rep = a.rep;
-
-  a.members.insert(a.end(), b.begin(), b.end());
-
-  b.members.clear();
+template <size_t N> Cluster BasicDSU<N>::cluster(int i) const {
+  const int rep = find_rep(i);
+  return Cluster{rep, m_colors[rep], m_sizes[rep], m_next[m_last[rep]],
+                 m_next.data()};
 }
+
+template class BasicDSU<WIDTH * HEIGHT>;
+template class BasicDSU<20 * 20>;
@@ -3,36 +3,107 @@
 
 #include "types.h"
 
+#include <array>
 #include <cstddef>
-#include <vector>
+#include <cstdint>
+#include <iterator>
+#include <limits>
 
-struct Cluster {
+/**
+ * View of a cluster of cells, whose members are linked in a cycle. It holds
+ * no storage of its own and is only valid until the clusters change.
+ */
+class Cluster {
+public:
+  // Type of the links between the members, cell indices fit on 16 bits.
+  using Link = uint16_t;
+
+  class iterator {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = int;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const int *;
+    using reference = int;
+
+    iterator(const Link *next, int i, size_t n)
+        : m_next{next}, m_i{i}, m_n{n} {}
+
+    int operator*() const { return m_i; }
+    iterator &operator++() {
+      m_i = m_next[m_i];
+      --m_n;
+      return *this;
+    }
+    iterator operator++(int) {
+      iterator ret = *this;
+      ++*this;
+      return ret;
+    }
+    bool operator==(const iterator &other) const { return m_n == other.m_n; }
+    bool operator!=(const iterator &other) const { return m_n != other.m_n; }
+
+  private:
+    const Link *m_next;
+    int m_i;
+    // Members left to visit.
+    size_t m_n;
+  };
 
-  explicit Cluster(int r) : rep{r}, members(1, r) {}
+  Cluster() = default;
 
-  mutable int rep;
+  /**
+   * @Param rep  The representative of the cluster.
+   * @Param color  The color of its cells.
+   * @Param size  The number of its members.
+   * @Param first  The member to start from.
+   * @Param next  The member following each member.
+   */
+  Cluster(int rep, Color color, size_t size, int first, const Link *next)
+      : rep{rep}, color{color}, m_size{size}, m_first{first}, m_next{next} {}
+
+  int rep{-1};
   Color color{Color::Empty};
-  std::vector<int> members;
 
-  size_t size() const { return members.size(); }
-  auto begin() { return members.begin(); }
-  auto begin() const { return members.begin(); }
-  auto end() { return members.end(); }
-  auto end() const { return members.end(); }
+  size_t size() const { return m_size; }
+  iterator begin() const { return iterator{m_next, m_first, m_size}; }
+  iterator end() const { return iterator{m_next, m_first, 0}; }
+
+private:
+  size_t m_size{0};
+  int m_first{-1};
+  const Link *m_next{nullptr};
 };
 
 /**
- * Disjoint set union data structure for forming clusters.
+ * Disjoint set union data structure for forming clusters of N cells.
+ *
+ * Everything is stored in flat arrays of the object itself, the members of
+ * each cluster being linked in a cycle through `m_next`, so that it needs
+ * no allocation and a few bytes per cell.
  */
-class DSU {
+template <size_t N> class BasicDSU {
 public:
-  explicit DSU(size_t size);
+  using Link = Cluster::Link;
+
+  static_assert(N <= std::numeric_limits<Link>::max() + size_t{1});
+
+  BasicDSU();
 
   /**
    * Resets datastructure so that each cells are made disjoint.
    */
   void reset();
 
+  /**
+   * Make the cell at index i a cluster of its own, leaving the other
+   * cells untouched.
+   *
+   * Note: The caller is responsible for detaching every other member of
+   * the cell's cluster as well.
+   */
+  void reset(int i);
+
   /**
    * Find the representative of the cluster to which a given cell belongs.
    *
@@ -43,30 +114,40 @@ public:
 
   /**
    * Merge the two clusters to which the two given cells belong.
+   * The representative of the result is its member of smallest index.
    *
    * @Param a  The index of the first cell.
    * @Param b  The index of the second cell.
    */
   void unite(int a, int b);
 
-  Cluster &operator[](size_t i) { return m_clusters[i]; }
-  const Cluster &operator[](size_t i) const { return m_clusters[i]; }
-  auto begin() const { return m_clusters.begin(); }
-  auto end() const { return m_clusters.end(); }
-  size_t size() const { return m_clusters.size(); }
-
-private:
-  std::vector<Cluster> m_clusters;
-
   /**
-   * Append a cluster at the end of another one.
-   *
-   * @Param a  The receiving cluster.
-   * @Param b  The appended cluster.
+   * Get the cluster to which the cell at index i belongs.
    */
-  void merge_clusters(Cluster &a, Cluster &b);
+  Cluster cluster(int i) const;
+
+  Color &color(int i) { return m_colors[i]; }
+  Color color(int i) const { return m_colors[i]; }
+
+  static constexpr size_t size() { return N; }
+
+private:
+  // Parent of each cell in the forest of the clusters.
+  mutable std::array<Link, N> m_parents;
+  // Next member of the cluster of each cell.
+  std::array<Link, N> m_next;
+  // Size and last member of each cluster, only kept up to date at the
+  // representatives. The first member follows the last one.
+  std::array<Link, N> m_sizes;
+  std::array<Link, N> m_last;
+  std::array<Color, N> m_colors;
 };
 
+using DSU = BasicDSU<WIDTH * HEIGHT>;
+
+extern template class BasicDSU<WIDTH * HEIGHT>;
+extern template class BasicDSU<20 * 20>;
+
 inline bool operator==(const Cluster &a, const Cluster &b) {
   return a.rep == b.rep;
 }
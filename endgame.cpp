@@ -0,0 +1,88 @@
+#include "endgame.h"
+#include "bounds.h"
+
+#include <algorithm>
+#include <iterator>
+
+template <typename Game>
+BasicEndgameSolver<Game>::BasicEndgameSolver(size_t memo_size)
+    : m_memo{memo_size}, m_nodes{0} {
+  // There are at most W * H / 2 moves in a game, plus the final position.
+  constexpr size_t max_moves = Game::width() * Game::height() / 2;
+  m_moves.resize(max_moves + 1);
+  for (auto &moves : m_moves) {
+    moves.reserve(max_moves);
+  }
+}
+
+template <typename Game>
+void BasicEndgameSolver<Game>::solve(const Game &sg, Solution &solution) {
+  m_game.set_state(sg.state());
+
+  solution.score = search(0);
+  solution.moves.clear();
+
+  // Follow the moves which achieve the best score, whose children are in
+  // the memo unless they were overwritten.
+  for (double left = solution.score;;) {
+    std::vector<Move> &moves = m_moves[0];
+    moves.clear();
+    m_game.moves(std::back_inserter(moves));
+
+    const auto it =
+        std::find_if(moves.begin(), moves.end(), [&](const Move &move) {
+          m_game.apply(move.action);
+          const double score = search(1);
+          m_game.undo();
+          return move.score + score == left;
+        });
+    if (it == moves.end()) {
+      break;
+    }
+
+    left -= it->score;
+    solution.moves.push_back(it->action);
+    m_game.apply(it->action);
+  }
+
+  solution.clears = m_game.get_color_count(Color::Empty) ==
+                    Game::width() * Game::height();
+}
+
+template <typename Game> double BasicEndgameSolver<Game>::search(size_t depth) {
+  ++m_nodes;
+
+  const uint64_t key = m_game.hash();
+  if (TranspositionTable::Entry entry; m_memo.probe(key, entry)) {
+    return entry.score;
+  }
+
+  std::vector<Move> &moves = m_moves[depth];
+  moves.clear();
+  m_game.moves(std::back_inserter(moves));
+
+  // The largest clusters first, so that a good sequence is found early and
+  // the bounds cut more of the others.
+  std::sort(moves.begin(), moves.end(),
+            [](const Move &a, const Move &b) { return a.size > b.size; });
+
+  double best = 0.0;
+  for (const Move &move : moves) {
+    if (move.score + Bounds::upper_bound(m_game, move) <= best) {
+      continue;
+    }
+    m_game.apply(move.action);
+    best = std::max(best, move.score + search(depth + 1));
+    m_game.undo();
+  }
+
+  // The larger positions are the most expensive to solve again, so they
+  // take precedence in the memo.
+  const int n_cells = Game::width() * Game::height() -
+                      m_game.get_color_count(Color::Empty);
+  m_memo.store(key, best, n_cells);
+  return best;
+}
+
+template class BasicEndgameSolver<BasicSameGame<WIDTH, HEIGHT, NB_COLORS>>;
+template class BasicEndgameSolver<BasicSameGame<20, 20, NB_COLORS>>;
@@ -0,0 +1,97 @@
+#ifndef ENDGAME_H_
+#define ENDGAME_H_
+
+#include "samegame.h"
+#include "transposition.h"
+
+#include <utility>
+#include <vector>
+
+/**
+ * Exact solver of the positions with few cells left.
+ *
+ * An exhaustive depth-first search, whose results are memorized in a
+ * #TranspositionTable keyed by the hash of the positions. The moves are
+ * tried from the largest cluster down, and those after which
+ * Bounds::upper_bound() cannot beat the best move found so far are skipped,
+ * which keeps the values exact.
+ */
+template <typename Game> class BasicEndgameSolver {
+public:
+  struct Solution {
+    // Best score which can be collected from the position.
+    double score;
+    // Whether the best sequence clears the board.
+    bool clears;
+    std::vector<Action> moves;
+  };
+
+  /**
+   * @Param memo_size  The number of slots of the memo.
+   */
+  explicit BasicEndgameSolver(size_t memo_size = 1 << 18);
+
+  /**
+   * Find the best sequence of moves from the current position of `sg`.
+   */
+  void solve(const Game &sg, Solution &solution);
+
+  /**
+   * Number of positions visited by the searches so far.
+   */
+  size_t n_nodes() const { return m_nodes; }
+
+private:
+  TranspositionTable m_memo;
+  Game m_game;
+  // The moves of the positions of the current line, by depth.
+  std::vector<std::vector<Move>> m_moves;
+  size_t m_nodes;
+
+  /**
+   * Best score which can be collected from the position of `m_game`, which
+   * is left unchanged.
+   */
+  double search(size_t depth);
+};
+
+/**
+ * Plays like `Policy` until at most `threshold` cells are left on the
+ * board, and then plays the best sequence found by a #BasicEndgameSolver.
+ */
+template <typename Game, typename Policy> class BasicPolicyEndgame {
+public:
+  explicit BasicPolicyEndgame(Policy policy = Policy{}, int threshold = 40)
+      : m_policy{std::move(policy)}, m_threshold{threshold} {}
+
+  std::pair<bool, Action> operator()(const Game &sg) {
+    const int n_cells = Game::width() * Game::height() -
+                        sg.get_color_count(Color::Empty);
+    if (n_cells > m_threshold) {
+      return m_policy(sg);
+    }
+
+    // The memo makes it cheap to solve the following positions again.
+    m_solver.solve(sg, m_solution);
+    if (m_solution.moves.empty()) {
+      return std::make_pair(false, Action{-1});
+    }
+    return std::make_pair(true, m_solution.moves.front());
+  }
+
+private:
+  Policy m_policy;
+  int m_threshold;
+  BasicEndgameSolver<Game> m_solver;
+  typename BasicEndgameSolver<Game>::Solution m_solution;
+};
+
+using EndgameSolver = BasicEndgameSolver<SameGame>;
+
+template <typename Policy>
+using PolicyEndgame = BasicPolicyEndgame<SameGame, Policy>;
+
+extern template class BasicEndgameSolver<BasicSameGame<WIDTH, HEIGHT, NB_COLORS>>;
+extern template class BasicEndgameSolver<BasicSameGame<20, 20, NB_COLORS>>;
+
+#endif // ENDGAME_H_
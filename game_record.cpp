@@ -0,0 +1,125 @@
+#include "game_record.h"
+
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+
+constexpr char MAGIC[4] = {'S', 'G', 'R', '1'};
+
+void put(uint8_t *&p, uint64_t value, int n_bytes) {
+  for (int k = 0; k < n_bytes; ++k) {
+    *p++ = value >> (8 * k) & 0xff;
+  }
+}
+
+uint64_t get(const uint8_t *&p, int n_bytes) {
+  uint64_t ret = 0;
+  for (int k = n_bytes - 1; k >= 0; --k) {
+    ret = ret << 8 | p[k];
+  }
+  p += n_bytes;
+  return ret;
+}
+
+} // namespace
+
+void Records::write(const std::string &path, const BoardShape &shape,
+                    const std::vector<GameRecord> &records) {
+  std::ofstream ofs{path, std::ios::binary};
+
+  uint8_t header[HEADER_SIZE] = {};
+  std::memcpy(header, MAGIC, sizeof(MAGIC));
+  header[4] = shape.width;
+  header[5] = shape.height;
+  header[6] = shape.nb_colors;
+  uint8_t *p = header + 8;
+  put(p, records.size(), 8);
+  ofs.write(reinterpret_cast<const char *>(header), sizeof(header));
+
+  std::vector<uint8_t> buf;
+  for (const GameRecord &record : records) {
+    buf.clear();
+    append(record, buf);
+    ofs.write(reinterpret_cast<const char *>(buf.data()), buf.size());
+  }
+
+  if (not ofs.flush()) {
+    throw std::runtime_error("Failed to write records " + path);
+  }
+}
+
+void Records::read(const std::string &path, BoardShape &shape,
+                   std::vector<GameRecord> &records) {
+  std::ifstream ifs{path, std::ios::binary};
+  if (not ifs) {
+    throw std::runtime_error("Failed to open records " + path);
+  }
+
+  // Read the whole file at once, it is parsed in place.
+  ifs.seekg(0, std::ios::end);
+  std::vector<uint8_t> data(ifs.tellg());
+  ifs.seekg(0);
+  ifs.read(reinterpret_cast<char *>(data.data()), data.size());
+
+  if (not ifs || data.size() < HEADER_SIZE ||
+      std::memcmp(data.data(), MAGIC, sizeof(MAGIC)) != 0) {
+    throw std::runtime_error("Invalid records header in " + path);
+  }
+
+  shape = BoardShape{data[4], data[5], data[6]};
+  const uint8_t *p = data.data() + 8;
+  const uint64_t size = get(p, 8);
+  const uint8_t *const last = data.data() + data.size();
+
+  records.clear();
+  records.reserve(std::min<uint64_t>(size, data.size() / RECORD_HEADER_SIZE));
+
+  for (uint64_t i = 0; i < size; ++i) {
+    if (not parse(p, last, records.emplace_back())) {
+      throw std::runtime_error("Truncated records in " + path);
+    }
+  }
+}
+
+void Records::append(const GameRecord &record, std::vector<uint8_t> &out) {
+  if (record.score != std::floor(record.score) || record.score < 0 ||
+      record.score > std::numeric_limits<uint32_t>::max()) {
+    throw std::invalid_argument("Record scores must fit on 32 bits");
+  }
+  if (record.moves.size() > std::numeric_limits<uint16_t>::max()) {
+    throw std::invalid_argument("Too many moves in a record");
+  }
+
+  const size_t offset = out.size();
+  out.resize(offset + RECORD_HEADER_SIZE);
+  uint8_t *p = out.data() + offset;
+  put(p, record.board_hash, 8);
+  put(p, record.seed, 4);
+  put(p, static_cast<uint32_t>(record.score), 4);
+  put(p, record.moves.size(), 2);
+  out.insert(out.end(), record.moves.begin(), record.moves.end());
+}
+
+bool Records::parse(const uint8_t *&p, const uint8_t *last,
+                    GameRecord &record) {
+  if (last - p < static_cast<ptrdiff_t>(RECORD_HEADER_SIZE)) {
+    return false;
+  }
+
+  const uint8_t *q = p;
+  record.board_hash = get(q, 8);
+  record.seed = get(q, 4);
+  record.score = get(q, 4);
+  const size_t n_moves = get(q, 2);
+
+  if (last - q < static_cast<ptrdiff_t>(n_moves)) {
+    return false;
+  }
+  record.moves.assign(q, q + n_moves);
+  p = q + n_moves;
+  return true;
+}
@@ -0,0 +1,174 @@
+#ifndef GAME_RECORD_H_
+#define GAME_RECORD_H_
+
+#include "types.h"
+#include "samegame.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * A game played from a board, compact enough to keep the solutions of long
+ * search runs.
+ *
+ * The board is only known by its hash, and each move takes a single byte:
+ * the rank of its cluster among the valid ones, see Records::encode_move().
+ */
+struct GameRecord {
+  // Zobrist hash of the board the game starts from, see #Zobrist.
+  uint64_t board_hash;
+  // Seed of the policy which played the game.
+  uint32_t seed;
+  // Score claimed for the game.
+  double score;
+  std::vector<uint8_t> moves;
+};
+
+/**
+ * Encoding, replay and storage of #GameRecord.
+ *
+ * A file of records starts with a 16 bytes header: the magic "SGR1", the
+ * width, the height and the number of colors of the boards as one byte each,
+ * a zero byte, then the number of records as a little-endian 64 bits
+ * integer. Each record follows with its board hash on 8 bytes, its seed on
+ * 4 bytes, its score on 4 bytes, its number of moves on 2 bytes, all
+ * little-endian, and then its moves.
+ */
+namespace Records {
+
+constexpr size_t HEADER_SIZE = 16;
+
+// Size of a record before its moves.
+constexpr size_t RECORD_HEADER_SIZE = 18;
+
+/**
+ * Write the records of games played on boards of the given shape to
+ * `path`. Throws std::invalid_argument if a score is not a whole number of
+ * 32 bits or if a game has too many moves.
+ */
+void write(const std::string &path, const BoardShape &shape,
+           const std::vector<GameRecord> &records);
+
+/**
+ * Read the records of `path`, along with the shape of their boards. Throws
+ * std::runtime_error if the file cannot be read or is not valid.
+ */
+void read(const std::string &path, BoardShape &shape,
+          std::vector<GameRecord> &records);
+
+/**
+ * Append a record to `out`, laid out as in a file. Throws
+ * std::invalid_argument if its score is not a whole number of 32 bits or
+ * if it has too many moves.
+ */
+void append(const GameRecord &record, std::vector<uint8_t> &out);
+
+/**
+ * Parse the record laid out at `p`, moving `p` past it.
+ *
+ * @Return false if the record does not end by `last`, `p` being left as is.
+ */
+bool parse(const uint8_t *&p, const uint8_t *last, GameRecord &record);
+
+namespace detail {
+
+/**
+ * Whether the representative of each cluster is its first cell in reading
+ * order, as in the DSU backend.
+ */
+template <typename Game> constexpr bool rep_is_first() {
+  for (size_t i = 0; i < Game::width() * Game::height(); ++i) {
+    if (Game::rep_rank(i) != static_cast<int>(i)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * First cell in reading order of the cluster represented by `rep`, which
+ * does not depend on the backend.
+ */
+template <typename Game> int first_cell(const Game &sg, int rep) {
+  if constexpr (rep_is_first<Game>()) {
+    return rep;
+  } else {
+    const Cluster cluster = sg.get_cluster(rep);
+    return *std::min_element(cluster.begin(), cluster.end());
+  }
+}
+
+} // namespace detail
+
+/**
+ * Encode a valid action of `sg` as the number of valid clusters coming
+ * before its own, ordering them by their first cell in reading order.
+ *
+ * A board has at most W * H / 2 valid clusters, so that this fits on a
+ * byte for the boards of up to 512 cells.
+ */
+template <typename Game> uint8_t encode_move(const Game &sg, Action action) {
+  static_assert(Game::width() * Game::height() <= 512);
+
+  const int first = detail::first_cell(sg, action.index);
+  int rank = 0;
+  for (const ClusterInfo &cluster : sg.clusters()) {
+    rank += detail::first_cell(sg, cluster.rep) < first;
+  }
+  return rank;
+}
+
+/**
+ * Inverse of #encode_move().
+ *
+ * @Return false if `sg` does not have that many valid clusters.
+ */
+template <typename Game>
+bool decode_move(const Game &sg, uint8_t move, Action &action) {
+  constexpr size_t MAX_CLUSTERS = Game::width() * Game::height() / 2;
+
+  const auto &clusters = sg.clusters();
+  if (move >= clusters.size()) {
+    return false;
+  }
+
+  // Pairs of the first cell and the representative of each cluster.
+  std::array<std::pair<int, int>, MAX_CLUSTERS> keys;
+  for (size_t k = 0; k < clusters.size(); ++k) {
+    keys[k] = {detail::first_cell(sg, clusters[k].rep), clusters[k].rep};
+  }
+  std::nth_element(keys.begin(), keys.begin() + move,
+                   keys.begin() + clusters.size());
+
+  action = Action{keys[move].second};
+  return true;
+}
+
+/**
+ * Play the moves of a record from the current position of `sg`, adding up
+ * their scores in `score`.
+ *
+ * @Return false if a move is not valid, `sg` being left after the moves
+ * played until then.
+ */
+template <typename Game>
+bool replay(Game &sg, const GameRecord &record, double &score) {
+  score = 0.0;
+  for (const uint8_t move : record.moves) {
+    Action action;
+    if (not decode_move(sg, move, action)) {
+      return false;
+    }
+    score += sg.score(action);
+    sg.apply(action);
+  }
+  return true;
+}
+
+} // namespace Records
+
+#endif // GAME_RECORD_H_
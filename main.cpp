@@ -1,79 +1,750 @@
 #include "types.h"
 #include "policy.h"
+#include "beam.h"
 #include "agent.h"
+#include "anytime.h"
+#include "board_gen.h"
+#include "board_io.h"
+#include "cli.h"
+#include "daemon.h"
+#include "dispatch.h"
+#include "endgame.h"
+#include "game_record.h"
+#include "parallel.h"
 #include "samegame.h"
-#include "viewer.h"
+#include "solution_cache.h"
+#include "stats.h"
+#include "thread_pool.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <fstream>
+#include <functional>
+#include <iomanip>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
 #include <string>
-#include <tuple>
-
-enum class Agent { Random, Greedy, ColorCount };
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
 
 using namespace std;
 
-typedef std::vector< std::tuple< double, double, double > > Results;
+namespace {
+
+const vector<string> policy_names = {
+    "random",       "greedy", "colorcount", "nmcs",     "greedy+endgame",
+    "nmcs+endgame", "beam",   "anytime",    "nmcs-root"};
+
+// Play one game on a board with the given seed, returning the score. The
+// game is recorded unless the record is null.
+template <typename Game>
+using Runner =
+    function<double(const typename Game::Board &, unsigned, GameRecord *)>;
 
-void print_scores(const Results& results){
-  auto t = 1;
-  for (auto [score_random, score_greedy, score_ccount] : results) {
-    cout << "\n\nTest " << t++
-         << ":\n  AgentRandom: " << score_random
-         << ",\n  AgentGreedy: " << score_greedy
-         << ",\n  AgentColorCount: " << score_ccount << endl;
+// Play a board, starting from the line known in the cache unless it is null.
+template <typename Game, typename Policy>
+double play_board(const typename Game::Board &board, Policy &&policy,
+                  GameRecord *record, SolutionCache *cache) {
+  Game sg;
+  sg.load(board);
+  if (cache) {
+    GameRecord scratch{};
+    return play(sg, policy, *cache, record ? *record : scratch);
   }
+  return record ? play(sg, policy, *record) : play(sg, policy);
 }
 
+template <typename Game>
+map<string, Runner<Game>> make_runners(const TimeControl &time,
+                                       size_t search_threads,
+                                       SolutionCache *cache) {
+  using Board = typename Game::Board;
 
-int main(int argc, char *argv[]) {
-  // if (argc < 2) {
-  //   cerr << "USAGE: " << argv[0] << " INPUT FILE" << endl;
-  //   return EXIT_FAILURE;
-  // }
-  // std::string input_fn = DATA_DIR + std::string(argv[1]);
+  map<string, Runner<Game>> runners = {
+      {"random",
+       [cache](const Board &board, unsigned seed, GameRecord *record) {
+         return play_board<Game>(board, PolicyRandom{seed}, record, cache);
+       }},
+      {"greedy",
+       [cache](const Board &board, unsigned, GameRecord *record) {
+         return play_board<Game>(board, PolicyGreedy{}, record, cache);
+       }},
+      {"colorcount",
+       [cache](const Board &board, unsigned, GameRecord *record) {
+         return play_board<Game>(board, PolicyLowColorCount{}, record, cache);
+       }},
+      {"greedy+endgame",
+       [cache](const Board &board, unsigned, GameRecord *record) {
+         return play_board<Game>(
+             board, BasicPolicyEndgame<Game, PolicyGreedy>{}, record, cache);
+       }},
+  };
 
-  Results scores;
+  // The tree searches only work on the default board shape.
+  if constexpr (is_same_v<Game, SameGame>) {
+    runners["nmcs"] = [cache](const Board &board, unsigned seed,
+                              GameRecord *record) {
+      return play_board<Game>(board, PolicyNMCS{1, seed}, record, cache);
+    };
+    runners["nmcs+endgame"] = [cache](const Board &board, unsigned seed,
+                                      GameRecord *record) {
+      return play_board<Game>(board,
+                              PolicyEndgame<PolicyNMCS>{PolicyNMCS{1, seed}},
+                              record, cache);
+    };
+    runners["beam"] = [cache](const Board &board, unsigned,
+                              GameRecord *record) {
+      return play_board<Game>(board, PolicyBeam{}, record, cache);
+    };
+    runners["anytime"] = [time, cache](const Board &board, unsigned seed,
+                                       GameRecord *record) {
+      return play_board<Game>(board, PolicyAnytime{time, 3, seed}, record,
+                              cache);
+    };
+    runners["nmcs-root"] = [search_threads, cache](const Board &board,
+                                                   unsigned seed,
+                                                   GameRecord *record) {
+      return play_board<Game>(
+          board, PolicyRootParallel{1, search_threads, seed}, record, cache);
+    };
+  }
 
-  for(auto t = 1; t < 51; ++t) {
+  return runners;
+}
+
+struct Options {
+  vector<string> policies{"random", "greedy", "colorcount"};
+  string boards = DATA_DIR + string("test*.txt");
+  int repeat = 1;
+  unsigned seed = 0;
+  size_t threads = thread::hardware_concurrency();
+  size_t search_threads = thread::hardware_concurrency();
+  bool verbose = false;
+  string save_corpus;
+  string save_records;
+  string verify_records;
+  TimeControl time{chrono::milliseconds{10}};
+  string cache;
+  bool daemon = false;
+  uint64_t generate = 0;
+  BoardShape shape{WIDTH, HEIGHT, NB_COLORS};
+  vector<double> weights;
+  uint64_t board_seed = 0;
+  string save_boards;
+};
 
-    //auto& [score_random, score_greedy, score_ccount] = scores.emplace_back();
-    auto& scores_vec = scores.emplace_back();
+struct Job {
+  size_t board;
+  size_t policy;
+  unsigned seed;
+  double score;
+  double seconds;
+  GameRecord record;
+};
 
-    std::string input_fn = DATA_DIR + std::string("test") + std::to_string(t) + ".txt";
+void print_usage(const char *prog) {
+  cerr << "USAGE: " << prog << " [OPTIONS]\n\n"
+       << "  --policies P1,P2,...  Policies to evaluate, among:";
+  for (const auto &name : policy_names) {
+    cerr << ' ' << name;
+  }
+  cerr << "\n"
+       << "                        (default: random,greedy,colorcount)\n"
+       << "  --boards PATTERN      Glob pattern of the board files, text\n"
+       << "                        files or binary corpora of the same\n"
+       << "                        shape (default: " << DATA_DIR
+       << "test*.txt)\n"
+       << "  --repeat N            Games per board and policy, with\n"
+       << "                        different seeds (default: 1)\n"
+       << "  --seed S              Seed of the first repetition (default: 0)\n"
+       << "  --threads N           Number of worker threads\n"
+       << "                        (default: hardware concurrency)\n"
+       << "  --search-threads N    Threads of each nmcs-root search, which\n"
+       << "                        add up with --threads (default: hardware\n"
+       << "                        concurrency)\n"
+       << "  --verbose             Print the score of every game\n"
+       << "  --save-corpus FILE    Write the boards to a binary corpus and\n"
+       << "                        exit\n"
+       << "  --save-records FILE   Write the games played to a file of\n"
+       << "                        records, see game_record.h\n"
+       << "  --verify-records FILE Replay the records of a file on the\n"
+       << "                        boards, checking their scores, and exit\n"
+       << "  --move-ms N           Time per move of the anytime policy, in\n"
+       << "                        milliseconds (default: 10)\n"
+       << "  --game-ms N           Time per game of the anytime policy, in\n"
+       << "                        milliseconds (default: no limit)\n"
+       << "  --cache FILE          Start every game from the best line known\n"
+       << "                        in a solution cache, storing back the\n"
+       << "                        better ones, see solution_cache.h\n"
+       << "  --daemon              Answer requests on stdin until quit, see\n"
+       << "                        daemon.h\n"
+       << "  --generate N          Play N random boards instead of the board\n"
+       << "                        files, see board_gen.h\n"
+       << "  --shape WxHxC         Shape of the random boards\n"
+       << "                        (default: " << WIDTH << 'x' << HEIGHT << 'x'
+       << NB_COLORS << ")\n"
+       << "  --weights W1,W2,...   Relative frequencies of the colors of the\n"
+       << "                        random boards (default: uniform)\n"
+       << "  --board-seed S        Seed of the random boards (default: 0)\n"
+       << "  --save-boards FILE    Write the random boards to a text file and\n"
+       << "                        exit\n";
+}
 
-    for (auto i : { 0, 1, 2 }) {
-      ifstream ifs{input_fn};
-      if (not ifs) {
-        cerr << "Failed to open input file " << input_fn << endl;
-        return EXIT_FAILURE;
+vector<string> split(const string &s, char sep) {
+  vector<string> ret;
+  istringstream iss{s};
+  for (string item; getline(iss, item, sep);) {
+    if (not item.empty()) {
+      ret.push_back(item);
+    }
+  }
+  return ret;
+}
+
+bool parse_options(int argc, char *argv[], Options &options) {
+  for (int i = 1; i < argc; ++i) {
+    const string arg = argv[i];
+    const bool has_value = i + 1 < argc;
+
+    try {
+      if (arg == "--verbose") {
+        options.verbose = true;
+      } else if (arg == "--daemon") {
+        options.daemon = true;
+      } else if (arg == "--policies" && has_value) {
+        options.policies = split(argv[++i], ',');
+      } else if (arg == "--boards" && has_value) {
+        options.boards = argv[++i];
+      } else if (arg == "--repeat" && has_value) {
+        options.repeat = Cli::parse_unsigned<int>(argv[++i]);
+      } else if (arg == "--seed" && has_value) {
+        options.seed = Cli::parse_unsigned<unsigned>(argv[++i]);
+      } else if (arg == "--threads" && has_value) {
+        options.threads = Cli::parse_unsigned<size_t>(argv[++i]);
+      } else if (arg == "--search-threads" && has_value) {
+        options.search_threads = Cli::parse_unsigned<size_t>(argv[++i]);
+      } else if (arg == "--save-corpus" && has_value) {
+        options.save_corpus = argv[++i];
+      } else if (arg == "--save-records" && has_value) {
+        options.save_records = argv[++i];
+      } else if (arg == "--verify-records" && has_value) {
+        options.verify_records = argv[++i];
+      } else if (arg == "--cache" && has_value) {
+        options.cache = argv[++i];
+      } else if (arg == "--move-ms" && has_value) {
+        options.time.per_move =
+            chrono::milliseconds{Cli::parse_unsigned<uint32_t>(argv[++i])};
+      } else if (arg == "--game-ms" && has_value) {
+        options.time.per_game =
+            chrono::milliseconds{Cli::parse_unsigned<uint32_t>(argv[++i])};
+      } else if (arg == "--generate" && has_value) {
+        options.generate = Cli::parse_unsigned<uint64_t>(argv[++i]);
+      } else if (arg == "--shape" && has_value) {
+        const vector<string> dims = split(argv[++i], 'x');
+        if (dims.size() != 3) {
+          return false;
+        }
+        options.shape = BoardShape{Cli::parse_unsigned<size_t>(dims[0]),
+                                   Cli::parse_unsigned<size_t>(dims[1]),
+                                   Cli::parse_unsigned<int>(dims[2])};
+      } else if (arg == "--weights" && has_value) {
+        options.weights.clear();
+        for (const string &weight : split(argv[++i], ',')) {
+          options.weights.push_back(Cli::parse_double(weight));
+        }
+      } else if (arg == "--board-seed" && has_value) {
+        options.board_seed = Cli::parse_unsigned<uint64_t>(argv[++i]);
+      } else if (arg == "--save-boards" && has_value) {
+        options.save_boards = argv[++i];
+      } else {
+        return false;
       }
+    } catch (const logic_error &) {
+      // std::invalid_argument or std::out_of_range from the parsers.
+      cerr << "Invalid value for " << arg << endl;
+      return false;
+    }
+  }
 
-      double& score = i == 0? get< 0 >(scores_vec)
-        : i == 1? get< 1 >(scores_vec): get< 2 >(scores_vec);
+  return all_of(options.policies.begin(), options.policies.end(),
+                [](const auto &name) {
+                  if (find(policy_names.begin(), policy_names.end(), name) ==
+                      policy_names.end()) {
+                    cerr << "Unknown policy " << name << endl;
+                    return false;
+                  }
+                  return true;
+                }) &&
+         options.repeat > 0 &&
+         (options.save_boards.empty() || options.generate > 0);
+}
 
-      score = i == 0? run< PolicyRandom >(ifs)
-        : i == 1? run< PolicyGreedy >(ifs): run< PolicyLowColorCount >(ifs);
+bool read_file(const string &fn, string &text) {
+  ifstream ifs{fn};
+  if (not ifs) {
+    cerr << "Failed to open input file " << fn << endl;
+    return false;
+  }
+  ostringstream oss;
+  oss << ifs.rdbuf();
+  text = oss.str();
+  return true;
+}
+
+/**
+ * Shape of the boards of a file, that of its first board for a text file.
+ */
+bool probe_shape(const string &fn, BoardShape &shape) {
+  if (BoardCorpus::is_corpus(fn)) {
+    try {
+      shape = BoardCorpus{fn}.shape();
+    } catch (const runtime_error &e) {
+      cerr << e.what() << endl;
+      return false;
     }
+    return true;
+  }
+
+  string text;
+  if (not read_file(fn, text)) {
+    return false;
+  }
+  if (not BoardIO::shape(text.data(), text.data() + text.size(), shape)) {
+    cerr << "Invalid board in " << fn << endl;
+    return false;
   }
+  return true;
+}
 
-  print_scores(scores);
+/**
+ * Append the boards of a file to `boards`, along with a name for each of
+ * them. A text file may hold several boards one after the other.
+ */
+template <typename Game>
+bool load_boards(const string &fn, vector<typename Game::Board> &boards,
+                 vector<string> &names) {
+  if (BoardCorpus::is_corpus(fn)) {
+    unique_ptr<BoardCorpus> corpus;
+    try {
+      corpus = make_unique<BoardCorpus>(fn);
+    } catch (const runtime_error &e) {
+      cerr << e.what() << endl;
+      return false;
+    }
+    if (corpus->shape().width != Game::width() ||
+        corpus->shape().height != Game::height() ||
+        corpus->shape().nb_colors > Game::nb_colors()) {
+      cerr << "The boards of " << fn << " do not have the same shape as "
+           << "the others" << endl;
+      return false;
+    }
 
-  double sum_random = 0.0;
-  double sum_greedy = 0.0;
-  double sum_ccount = 0.0;
+    const size_t first = boards.size();
+    boards.resize(first + corpus->size());
+    for (size_t i = 0; i < corpus->size(); ++i) {
+      try {
+        corpus->get(i, boards[first + i]);
+      } catch (const runtime_error &) {
+        cerr << "Invalid board " << i << " in " << fn << endl;
+        return false;
+      }
+      names.push_back(fn + '#' + to_string(i));
+    }
+    return true;
+  }
 
-  auto t = 1;
-  for (const auto& [score_random, score_greedy, score_ccount] : scores) {
-    sum_random += score_random;
-    sum_greedy += score_greedy;
-    sum_ccount += score_ccount;
+  string text;
+  if (not read_file(fn, text)) {
+    return false;
   }
 
-  cout << "\n\n\nAverages:\n  AgentRandom: " << sum_random / scores.size()
-       << "\n  AgentGreedy: " << sum_greedy / scores.size()
-       << "\n  AgentColorCount: " << sum_ccount / scores.size() << endl;
+  const size_t first = boards.size();
+  const char *p = text.data();
+  const char *const last = p + text.size();
+
+  while (true) {
+    p = find_if(p, last, [](char c) { return not isspace(c); });
+    if (p == last) {
+      break;
+    }
+    p = BoardIO::parse(p, last, boards.emplace_back(), Game::nb_colors());
+    if (p == nullptr) {
+      cerr << "Invalid board in " << fn << endl;
+      return false;
+    }
+  }
+
+  const size_t n = boards.size() - first;
+  for (size_t i = 0; i < n; ++i) {
+    names.push_back(n == 1 ? fn : fn + '#' + to_string(i));
+  }
+  return true;
+}
+
+void print_summary(const Options &options, const vector<Job> &jobs,
+                   double wall_seconds) {
+  cout << '\n'
+       << left << setw(16) << "Policy" << right << setw(8) << "Games"
+       << setw(12) << "Mean" << setw(12) << "Std dev" << setw(10) << "Min"
+       << setw(10) << "Max" << setw(12) << "Time (s)" << '\n';
+
+  for (size_t p = 0; p < options.policies.size(); ++p) {
+    size_t n = 0;
+    double sum = 0.0, sum_sq = 0.0, seconds = 0.0;
+    double lo = INFINITY, hi = -INFINITY;
+
+    for (const Job &job : jobs) {
+      if (job.policy == p) {
+        ++n;
+        sum += job.score;
+        sum_sq += job.score * job.score;
+        seconds += job.seconds;
+        lo = min(lo, job.score);
+        hi = max(hi, job.score);
+      }
+    }
+
+    const double mean = sum / n;
+    const double var = n > 1 ? (sum_sq - n * mean * mean) / (n - 1) : 0.0;
+
+    cout << left << setw(16) << options.policies[p] << right << setw(8) << n
+         << fixed << setprecision(2) << setw(12) << mean << setw(12)
+         << sqrt(max(var, 0.0)) << setprecision(0) << setw(10) << lo
+         << setw(10) << hi << setprecision(3) << setw(12) << seconds << '\n';
+  }
+
+  cout << "\nWall time: " << setprecision(3) << wall_seconds << "s on "
+       << options.threads << " threads" << endl;
+}
+
+/**
+ * Replay the records of `options.verify_records` on the boards they were
+ * played from, found by their hash, and check the scores they claim.
+ */
+template <typename Game>
+int verify(const Options &options, const vector<typename Game::Board> &boards,
+           const vector<string> &names) {
+  BoardShape shape;
+  vector<GameRecord> records;
+  try {
+    Records::read(options.verify_records, shape, records);
+  } catch (const runtime_error &e) {
+    cerr << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+  if (shape.width != Game::width() || shape.height != Game::height()) {
+    cerr << "The records of " << options.verify_records
+         << " were not played on boards of the same shape" << endl;
+    return EXIT_FAILURE;
+  }
+
+  unordered_map<uint64_t, size_t> board_of;
+  {
+    Game sg;
+    for (size_t b = 0; b < boards.size(); ++b) {
+      sg.load(boards[b]);
+      board_of.emplace(sg.hash(), b);
+    }
+  }
+
+  enum class Verdict { Ok, UnknownBoard, InvalidMove, WrongScore };
+  const vector<string> verdict_names = {"ok", "unknown board", "invalid move",
+                                        "wrong score"};
+
+  vector<Verdict> verdicts(records.size());
+  vector<double> scores(records.size(), 0.0);
+
+  // The records are short, they are handed to the workers in chunks.
+  constexpr size_t CHUNK_SIZE = 256;
+
+  const auto start = chrono::steady_clock::now();
+  {
+    ThreadPool pool{options.threads};
+    for (size_t first = 0; first < records.size(); first += CHUNK_SIZE) {
+      pool.submit([&, first](size_t) {
+        Game sg;
+        const size_t last = min(first + CHUNK_SIZE, records.size());
+
+        for (size_t k = first; k < last; ++k) {
+          const auto it = board_of.find(records[k].board_hash);
+          if (it == board_of.end()) {
+            verdicts[k] = Verdict::UnknownBoard;
+            continue;
+          }
+          sg.load(boards[it->second]);
+          if (not Records::replay(sg, records[k], scores[k])) {
+            verdicts[k] = Verdict::InvalidMove;
+          } else if (scores[k] != records[k].score) {
+            verdicts[k] = Verdict::WrongScore;
+          } else {
+            verdicts[k] = Verdict::Ok;
+          }
+        }
+      });
+    }
+    pool.wait();
+  }
+  const double wall_seconds =
+      chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+  vector<size_t> counts(verdict_names.size(), 0);
+  size_t n_moves = 0;
+  for (size_t k = 0; k < records.size(); ++k) {
+    ++counts[static_cast<size_t>(verdicts[k])];
+    n_moves += records[k].moves.size();
+
+    if (options.verbose && verdicts[k] != Verdict::Ok) {
+      cout << "Record " << k << " seed " << records[k].seed << ": "
+           << verdict_names[static_cast<size_t>(verdicts[k])];
+      if (verdicts[k] != Verdict::UnknownBoard) {
+        cout << " on " << names[board_of.at(records[k].board_hash)]
+             << ", claimed " << records[k].score << ", replayed "
+             << scores[k];
+      }
+      cout << '\n';
+    }
+  }
+
+  cout << "\nVerified " << records.size() << " records of "
+       << options.verify_records << '\n';
+  for (size_t v = 0; v < verdict_names.size(); ++v) {
+    cout << "  " << left << setw(16) << verdict_names[v] << right << setw(10)
+         << counts[v] << '\n';
+  }
+  cout << "\nWall time: " << fixed << setprecision(3) << wall_seconds
+       << "s on " << options.threads << " threads, " << setprecision(0)
+       << records.size() / wall_seconds << " records/s, "
+       << n_moves / wall_seconds << " moves/s" << endl;
+
+  return counts[static_cast<size_t>(Verdict::Ok)] == records.size()
+             ? EXIT_SUCCESS
+             : EXIT_FAILURE;
+}
+
+/**
+ * Stream the boards of the generator to `options.save_boards` in the text
+ * format, which needs no instantiation of the game for their shape.
+ */
+int save_boards(const Options &options, const BoardGenerator &generator) {
+  ofstream ofs{options.save_boards};
+  if (not ofs) {
+    cerr << "Failed to open output file " << options.save_boards << endl;
+    return EXIT_FAILURE;
+  }
+
+  const BoardShape &shape = generator.shape();
+  vector<Color> cells(shape.width * shape.height);
+  for (uint64_t b = 0; b < options.generate && ofs; ++b) {
+    if (b > 0) {
+      ofs << '\n';
+    }
+    generator.generate(b, cells.data());
+    BoardIO::write(ofs, cells.data(), shape.width, shape.height);
+  }
+  ofs.close();
+
+  if (not ofs) {
+    cerr << "Failed to write " << options.save_boards << endl;
+    return EXIT_FAILURE;
+  }
+  cout << "Wrote " << options.generate << " boards to " << options.save_boards
+       << endl;
+  return EXIT_SUCCESS;
+}
+
+/**
+ * Play the jobs on the boards of the given files, which all have the shape
+ * of `Game`, or on the boards of the generator unless it is null.
+ */
+template <typename Game>
+int evaluate(const Options &options, const vector<string> &files,
+             const BoardGenerator *generator) {
+  const BoardShape shape{Game::width(), Game::height(), Game::nb_colors()};
+
+  unique_ptr<SolutionCache> cache;
+  if (not options.cache.empty()) {
+    try {
+      cache = make_unique<SolutionCache>(options.cache, shape);
+    } catch (const runtime_error &e) {
+      cerr << e.what() << endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  const auto runners = make_runners<Game>(options.time, options.search_threads,
+                                         cache.get());
+  for (const string &name : options.policies) {
+    if (runners.count(name) == 0) {
+      cerr << "Policy " << name << " does not support " << Game::width()
+           << "x" << Game::height() << " boards" << endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  // Parse every board once, the jobs share them. The generated boards are
+  // drawn by the jobs themselves instead, so that any number of them can be
+  // played, unless they are all needed at once.
+  vector<typename Game::Board> boards;
+  vector<string> names;
+  const bool lazy = generator && options.save_corpus.empty() &&
+                    options.verify_records.empty();
+
+  if (generator && not lazy) {
+    boards.resize(options.generate);
+    for (size_t b = 0; b < boards.size(); ++b) {
+      generator->generate(b, boards[b]);
+      names.push_back("gen#" + to_string(b));
+    }
+  }
+  for (const string &fn : generator ? vector<string>{} : files) {
+    if (not load_boards<Game>(fn, boards, names)) {
+      return EXIT_FAILURE;
+    }
+  }
+  const size_t n_boards = lazy ? options.generate : boards.size();
+
+  if (not options.save_corpus.empty()) {
+    BoardCorpus::write(options.save_corpus, shape, boards);
+    cout << "Wrote " << boards.size() << " boards to " << options.save_corpus
+         << endl;
+    return EXIT_SUCCESS;
+  }
+
+  if (not options.verify_records.empty()) {
+    return verify<Game>(options, boards, names);
+  }
+
+  const bool record = not options.save_records.empty();
+
+  vector<Job> jobs;
+  for (size_t b = 0; b < n_boards; ++b) {
+    for (size_t p = 0; p < options.policies.size(); ++p) {
+      for (int r = 0; r < options.repeat; ++r) {
+        jobs.push_back(Job{b, p, options.seed + r, 0.0, 0.0, {}});
+      }
+    }
+  }
+
+  const auto start = chrono::steady_clock::now();
+  {
+    ThreadPool pool{options.threads};
+    for (Job &job : jobs) {
+      pool.submit([&](size_t) {
+        const Runner<Game> &runner = runners.at(options.policies[job.policy]);
+
+        typename Game::Board board;
+        if (lazy) {
+          generator->generate(job.board, board);
+        }
+
+        const auto job_start = chrono::steady_clock::now();
+        job.record.seed = job.seed;
+        job.score = runner(lazy ? board : boards[job.board], job.seed,
+                           record ? &job.record : nullptr);
+        job.seconds = chrono::duration<double>(chrono::steady_clock::now() -
+                                               job_start)
+                          .count();
+      });
+    }
+    pool.wait();
+  }
+  const double wall_seconds =
+      chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+  if (options.verbose) {
+    for (const Job &job : jobs) {
+      cout << (lazy ? "gen#" + to_string(job.board) : names[job.board])
+           << ' ' << options.policies[job.policy]
+           << " seed " << job.seed << ": " << job.score << '\n';
+    }
+  }
+
+  print_summary(options, jobs, wall_seconds);
+
+  if (record) {
+    vector<GameRecord> records;
+    records.reserve(jobs.size());
+    for (Job &job : jobs) {
+      records.push_back(move(job.record));
+    }
+    Records::write(options.save_records, shape, records);
+    cout << "Wrote " << records.size() << " records to "
+         << options.save_records << endl;
+  }
+  if (cache) {
+    cout << "Solution cache " << options.cache << ": " << cache->size()
+         << " boards" << endl;
+  }
+#ifdef SG_STATS
+  Stats::report(cout);
+#endif
 
   return EXIT_SUCCESS;
 }
 
+} // namespace
+
+int main(int argc, char *argv[]) {
+  Options options;
+  if (not parse_options(argc, argv, options)) {
+    print_usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  if (options.daemon) {
+    // The searches of the daemon only work on the default board shape.
+    unique_ptr<SolutionCache> cache;
+    try {
+      if (not options.cache.empty()) {
+        cache = make_unique<SolutionCache>(
+            options.cache, BoardShape{WIDTH, HEIGHT, NB_COLORS});
+      }
+    } catch (const runtime_error &e) {
+      cerr << e.what() << endl;
+      return EXIT_FAILURE;
+    }
+    Daemon{options.time, options.seed, cache.get()}.run(cin, cout);
+    return EXIT_SUCCESS;
+  }
+
+  try {
+    if (options.generate > 0) {
+      const BoardGenerator generator{options.shape, options.board_seed,
+                                     options.weights};
+      if (not options.save_boards.empty()) {
+        return save_boards(options, generator);
+      }
+      return dispatch(generator.shape(), [&](auto tag) {
+        return evaluate<typename decltype(tag)::type>(options, {},
+                                                      &generator);
+      });
+    }
+
+    const vector<string> files = Cli::glob_files(options.boards);
+    if (files.empty()) {
+      cerr << "No board matches " << options.boards << endl;
+      return EXIT_FAILURE;
+    }
+
+    // The first file decides which instantiation of the game is used.
+    BoardShape shape;
+    if (not probe_shape(files.front(), shape)) {
+      return EXIT_FAILURE;
+    }
+
+    return dispatch(shape, [&](auto tag) {
+      return evaluate<typename decltype(tag)::type>(options, files, nullptr);
+    });
+  } catch (const invalid_argument &e) {
+    cerr << e.what() << endl;
+    return EXIT_FAILURE;
+  } catch (const runtime_error &e) {
+    // Files which cannot be written, such as a corpus.
+    cerr << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+}
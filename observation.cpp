@@ -0,0 +1,61 @@
+#include "observation.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+template <typename Game, typename T>
+void Observation::encode(const Game &sg, T *out) {
+  constexpr size_t N = Game::width() * Game::height();
+  constexpr int C = Game::nb_colors();
+  // Largest cluster size which fits in T.
+  constexpr int MAX_SIZE =
+      std::numeric_limits<T>::max() < N
+          ? static_cast<int>(std::numeric_limits<T>::max())
+          : static_cast<int>(N);
+
+  T *const sizes = out + C * N;
+  T *const mask = sizes + N;
+
+  std::fill(out, out + size<Game>(), T{0});
+
+#ifdef SG_BITBOARD
+  // Go through the bits of the color masks rather than testing each of them
+  // for every cell.
+  const typename Game::State state = sg.state();
+  for (int c = 0; c < C; ++c) {
+    state.masks[c].for_each([&](int b) {
+      const int i = Game::BitBoard::index_of(b);
+      out[c * N + i] = 1;
+      sizes[i] = 1;
+    });
+  }
+#else
+  for (size_t i = 0; i < N; ++i) {
+    const auto c =
+        static_cast<std::underlying_type_t<Color>>(sg.get_color(i));
+    if (c != 0) {
+      out[(c - 1) * N + i] = 1;
+      sizes[i] = 1;
+    }
+  }
+#endif
+
+  for (const ClusterInfo &info : sg.clusters()) {
+    const T value = std::min(info.size, MAX_SIZE);
+    for (const int i : sg.get_cluster(info.rep)) {
+      sizes[i] = value;
+      mask[i] = 1;
+    }
+  }
+}
+
+template void
+Observation::encode(const BasicSameGame<WIDTH, HEIGHT, NB_COLORS> &, float *);
+template void
+Observation::encode(const BasicSameGame<WIDTH, HEIGHT, NB_COLORS> &, uint8_t *);
+template void Observation::encode(const BasicSameGame<20, 20, NB_COLORS> &,
+                                  float *);
+template void Observation::encode(const BasicSameGame<20, 20, NB_COLORS> &,
+                                  uint8_t *);
@@ -0,0 +1,61 @@
+#ifndef OBSERVATION_H_
+#define OBSERVATION_H_
+
+#include "samegame.h"
+
+#include <cstddef>
+
+/**
+ * Encoding of boards as observations for learning agents, written straight
+ * into tensors provided by the caller.
+ *
+ * A batch of N boards is laid out in NCHW order, the value of channel c at
+ * row y and column x of board n being at
+ *
+ *     out[((n * channels() + c) * H + y) * W + x]
+ *
+ * where y = 0 is the top row, as for the cell indices of BasicSameGame. The
+ * channels are:
+ *  - 0 to C - 1: one plane per color, 1 where the cells have that color,
+ *  - C: the size of the cluster of each cell, 0 for the empty cells and 1
+ *    for the single cells, saturating at the largest value of the type,
+ *  - C + 1: the valid actions, 1 for the cells of the clusters of at least
+ *    two cells.
+ *
+ * The encoding only goes once over the cells and once over the members of
+ * the valid clusters, and does not allocate.
+ */
+namespace Observation {
+
+template <typename Game> constexpr size_t channels() {
+  return Game::nb_colors() + 2;
+}
+
+/**
+ * Number of values of the observation of a single board.
+ */
+template <typename Game> constexpr size_t size() {
+  return channels<Game>() * Game::height() * Game::width();
+}
+
+/**
+ * Write the observation of `sg` to `out`, which holds #size() values.
+ *
+ * @Param T  float or uint8_t.
+ */
+template <typename Game, typename T> void encode(const Game &sg, T *out);
+
+/**
+ * Write the observations of `n` games to `out`, which holds n * #size()
+ * values.
+ */
+template <typename Game, typename T>
+void encode(const Game *games, size_t n, T *out) {
+  for (size_t k = 0; k < n; ++k) {
+    encode(games[k], out + k * size<Game>());
+  }
+}
+
+} // namespace Observation
+
+#endif // OBSERVATION_H_
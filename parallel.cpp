@@ -0,0 +1,82 @@
+#include "parallel.h"
+
+#include <cassert>
+#include <random>
+
+PolicyRootParallel::PolicyRootParallel(int level, size_t n_threads)
+    : PolicyRootParallel{level, n_threads, std::random_device{}()} {}
+
+PolicyRootParallel::PolicyRootParallel(int level, size_t n_threads,
+                                       unsigned seed)
+    : m_level{level}, m_pool{n_threads}, m_best{-1.0, {}},
+      m_expected_hash{0}, m_root{WIDTH, HEIGHT} {
+  assert(level > 0);
+
+  const size_t max_moves = WIDTH * HEIGHT / 2;
+
+  for (size_t i = 0; i < m_pool.size(); ++i) {
+    m_searchers.push_back(std::make_unique<PolicyNMCS>(level, seed + i));
+  }
+
+  m_best.moves.reserve(max_moves);
+  m_moves.reserve(max_moves);
+  m_children.reserve(max_moves);
+  m_results.resize(max_moves);
+  for (Sequence &result : m_results) {
+    result.moves.reserve(max_moves);
+  }
+}
+
+std::pair<bool, Action> PolicyRootParallel::operator()(const SameGame &sg) {
+  // Forget the memorized sequence if we are not where it leads.
+  if (sg.hash() != m_expected_hash) {
+    m_best.score = -1.0;
+    m_best.moves.clear();
+  }
+
+  m_root.set_state(sg.state());
+
+  m_moves.clear();
+  m_root.moves(std::back_inserter(m_moves));
+
+  // Set up the children sequentially, the pool only runs the searches.
+  m_children.clear();
+  for (const Move &move : m_moves) {
+    m_root.apply(move.action);
+    m_children.push_back(m_root.state());
+    m_root.undo();
+  }
+
+  for (size_t i = 0; i < m_moves.size(); ++i) {
+    m_pool.submit([this, i](size_t worker) {
+      m_searchers[worker]->search(m_children[i], m_level - 1, m_results[i]);
+    });
+  }
+  m_pool.wait();
+
+  for (size_t i = 0; i < m_moves.size(); ++i) {
+    const Sequence &result = m_results[i];
+
+    if (const double total = m_moves[i].score + result.score;
+        total > m_best.score) {
+      m_best.score = total;
+      m_best.moves.clear();
+      m_best.moves.push_back(m_moves[i].action);
+      m_best.moves.insert(m_best.moves.end(), result.moves.begin(),
+                          result.moves.end());
+    }
+  }
+
+  if (m_best.moves.empty()) {
+    return std::make_pair(false, Action{-1});
+  }
+
+  const Action action = m_best.moves.front();
+  m_best.score -= m_root.score(action);
+  m_best.moves.erase(m_best.moves.begin());
+
+  m_root.apply(action);
+  m_expected_hash = m_root.hash();
+
+  return std::make_pair(true, action);
+}
@@ -0,0 +1,51 @@
+#ifndef PARALLEL_H_
+#define PARALLEL_H_
+
+#include "policy.h"
+#include "samegame.h"
+#include "thread_pool.h"
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+/**
+ * Root parallel Nested Monte Carlo Search.
+ *
+ * Plays like #PolicyNMCS, except that the searches following each of the
+ * valid actions at the root are spread over a #ThreadPool. Their results
+ * are merged at the root, where the best sequence found so far is
+ * memorized.
+ */
+class PolicyRootParallel {
+public:
+  explicit PolicyRootParallel(
+      int level = 1, size_t n_threads = std::thread::hardware_concurrency());
+
+  /**
+   * Same as above, the searcher of worker i being seeded with seed + i.
+   */
+  PolicyRootParallel(int level, size_t n_threads, unsigned seed);
+
+  std::pair<bool, Action> operator()(const SameGame &sg);
+
+private:
+  using Sequence = PolicyNMCS::Sequence;
+
+  int m_level;
+  ThreadPool m_pool;
+
+  // One searcher per worker of the pool.
+  std::vector<std::unique_ptr<PolicyNMCS>> m_searchers;
+
+  // Best sequence found from the position expected at the next call.
+  Sequence m_best;
+  uint64_t m_expected_hash;
+
+  SameGame m_root;
+  std::vector<Move> m_moves;
+  std::vector<SameGame::State> m_children;
+  std::vector<Sequence> m_results;
+};
+
+#endif // PARALLEL_H_
@@ -0,0 +1,282 @@
+#include "playout_batch.h"
+
+#include <algorithm>
+
+namespace {
+
+/**
+ * Whether any lane of a vector is non-zero.
+ */
+template <typename Lanes> inline bool any(const Lanes &v) {
+  for (size_t l = 0; l < sizeof(Lanes) / sizeof(v[0]); ++l) {
+    if (v[l] != 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * The lanes of `a` where `mask` is set, and those of `b` elsewhere.
+ */
+template <typename Lanes>
+inline Lanes select(const Lanes &mask, const Lanes &a, const Lanes &b) {
+  return (a & mask) | (b & ~mask);
+}
+
+/**
+ * Lower the labels of a cell to those of a neighbouring cell in the lanes
+ * where both have the same color, as given by the mask `same`.
+ *
+ * @Return The mask of the lanes where the label changed.
+ */
+template <typename Lanes>
+inline Lanes relax(Lanes &labels, const Lanes &other_labels,
+                   const Lanes &same) {
+  const Lanes changed = same & (Lanes)(other_labels < labels);
+  labels = select(changed, other_labels, labels);
+  return changed;
+}
+
+} // namespace
+
+template <size_t W, size_t H, int C>
+BasicPlayoutBatch<W, H, C>::BasicPlayoutBatch(unsigned seed)
+    : m_moves(N_CELLS / 2), m_gen{seed} {
+  // Dense ranks in the order of the game, so that they index `m_sizes`.
+  for (size_t i = 0; i < N_CELLS; ++i) {
+    m_ranks[i] = 0;
+    for (size_t j = 0; j < N_CELLS; ++j) {
+      m_ranks[i] += Game::rep_rank(j) < Game::rep_rank(i);
+    }
+  }
+  clear();
+}
+
+template <size_t W, size_t H, int C> void BasicPlayoutBatch<W, H, C>::clear() {
+  m_cells.fill(Lanes{});
+  m_scores.fill(0.0);
+  m_n_moves.fill(0);
+  m_n_cells.fill(0);
+}
+
+template <size_t W, size_t H, int C>
+void BasicPlayoutBatch<W, H, C>::load(size_t lane, const Game &sg) {
+  for (size_t i = 0; i < N_CELLS; ++i) {
+    m_cells[i][lane] = static_cast<Value>(sg.get_color(i));
+  }
+  m_n_cells[lane] = N_CELLS - sg.get_color_count(Color::Empty);
+}
+
+template <size_t W, size_t H, int C>
+void BasicPlayoutBatch<W, H, C>::run(Policy policy) {
+  m_scores.fill(0.0);
+  m_n_moves.fill(0);
+
+  Lanes actions;
+  Lanes picks;
+  Lanes sizes;
+
+  for (size_t k = 0;; ++k) {
+    label();
+    if (not pick(policy, actions, picks)) {
+      break;
+    }
+    remove(picks, sizes);
+
+    m_moves[k] = actions;
+    for (size_t l = 0; l < LANES; ++l) {
+      if (picks[l] == NOTHING) {
+        continue;
+      }
+      m_n_cells[l] -= sizes[l];
+      m_scores[l] += (sizes[l] - 2) * (sizes[l] - 2) +
+                     1000.0 * (m_n_cells[l] == 0);
+      ++m_n_moves[l];
+    }
+  }
+}
+
+// NOTE: The labels only go down, to the lowest rank of the cluster, and each
+// pair of sweeps carries them along the paths which go left and up then right
+// and down. Clusters are small and compact in practice, so only a few sweeps
+// are needed.
+template <size_t W, size_t H, int C> void BasicPlayoutBatch<W, H, C>::label() {
+  // The cells fall, so the empty rows are at the top.
+  for (m_first = 0; m_first < N_CELLS; m_first += W) {
+    Lanes row{};
+    for (size_t x = 0; x < W; ++x) {
+      row |= m_cells[m_first + x];
+    }
+    if (any(row)) {
+      break;
+    }
+  }
+
+  const Lanes none = Lanes{} + NONE;
+  for (size_t i = m_first; i < N_CELLS; ++i) {
+    const Lanes &cell = m_cells[i];
+    const Lanes empty = (Lanes)(cell == 0);
+    m_labels[i] = select(empty, none, Lanes{} + m_ranks[i]);
+    m_same_left[i] =
+        i % W > 0 ? ~empty & (Lanes)(cell == m_cells[i - 1]) : Lanes{};
+    m_same_up[i] =
+        i >= m_first + W ? ~empty & (Lanes)(cell == m_cells[i - W]) : Lanes{};
+  }
+
+  for (Lanes changed = ~Lanes{}; any(changed);) {
+    changed = Lanes{};
+
+    for (size_t i = m_first; i < N_CELLS; ++i) {
+      if (i % W > 0)
+        changed |= relax(m_labels[i], m_labels[i - 1], m_same_left[i]);
+      if (i >= m_first + W)
+        changed |= relax(m_labels[i], m_labels[i - W], m_same_up[i]);
+    }
+
+    for (size_t i = N_CELLS; i-- > m_first;) {
+      if (i % W < W - 1)
+        changed |= relax(m_labels[i], m_labels[i + 1], m_same_left[i + 1]);
+      if (i + W < N_CELLS)
+        changed |= relax(m_labels[i], m_labels[i + W], m_same_up[i + W]);
+    }
+  }
+}
+
+template <size_t W, size_t H, int C>
+bool BasicPlayoutBatch<W, H, C>::pick(Policy policy, Lanes &actions,
+                                      Lanes &picks) {
+  // A representative leads a cluster of at least two cells exactly when it
+  // has a neighbour of the same color.
+  Lanes n_valid{};
+  for (size_t i = m_first; i < N_CELLS; ++i) {
+    const Lanes &cell = m_cells[i];
+    Lanes same{};
+    if (i % W > 0)
+      same |= (Lanes)(cell == m_cells[i - 1]);
+    if (i % W < W - 1)
+      same |= (Lanes)(cell == m_cells[i + 1]);
+    if (i >= W)
+      same |= (Lanes)(cell == m_cells[i - W]);
+    if (i + W < N_CELLS)
+      same |= (Lanes)(cell == m_cells[i + W]);
+
+    m_valid[i] = same & (Lanes)(m_labels[i] == m_ranks[i]);
+    n_valid -= m_valid[i];
+  }
+
+  if (not any(n_valid)) {
+    return false;
+  }
+
+  actions = Lanes{};
+
+  if (policy == Policy::Random) {
+    // Pick the k-th valid action of each lane.
+    Lanes targets{};
+    for (size_t l = 0; l < LANES; ++l) {
+      if (n_valid[l] > 0) {
+        targets[l] =
+            std::uniform_int_distribution<int>(1, n_valid[l])(m_gen);
+      }
+    }
+
+    Lanes counts{};
+    for (size_t i = m_first; i < N_CELLS; ++i) {
+      counts -= m_valid[i];
+      const Lanes hit = m_valid[i] & (Lanes)(counts == targets);
+      actions = select(hit, Lanes{} + static_cast<Value>(i), actions);
+    }
+  } else {
+    m_sizes.fill(Lanes{});
+    for (size_t i = m_first; i < N_CELLS; ++i) {
+      for (size_t l = 0; l < LANES; ++l) {
+        if (const Value label = m_labels[i][l]; label != NONE) {
+          ++m_sizes[label][l];
+        }
+      }
+    }
+
+    Lanes best{};
+    for (size_t i = m_first; i < N_CELLS; ++i) {
+      const Lanes sizes = m_valid[i] & m_sizes[m_ranks[i]];
+      const Lanes better = (Lanes)(sizes > best);
+      actions = select(better, Lanes{} + static_cast<Value>(i), actions);
+      best = select(better, sizes, best);
+    }
+  }
+
+  for (size_t l = 0; l < LANES; ++l) {
+    picks[l] = n_valid[l] == 0 ? NOTHING : m_ranks[actions[l]];
+  }
+  return true;
+}
+
+template <size_t W, size_t H, int C>
+void BasicPlayoutBatch<W, H, C>::remove(const Lanes &picks, Lanes &sizes) {
+  sizes = Lanes{};
+  std::array<Lanes, W> dirty{};
+
+  for (size_t i = m_first; i < N_CELLS; ++i) {
+    const Lanes removed = (Lanes)(m_labels[i] == picks);
+    m_cells[i] &= ~removed;
+    sizes -= removed;
+    dirty[i % W] |= removed;
+  }
+
+  for (size_t x = 0; x < W; ++x) {
+    if (any(dirty[x])) {
+      gravity(x);
+    }
+  }
+  stack_columns();
+}
+
+// NOTE: Each sweep pulls the cells above a gap down by one row, so it takes
+// as many sweeps as the highest gap of the column in any lane.
+template <size_t W, size_t H, int C>
+void BasicPlayoutBatch<W, H, C>::gravity(size_t x) {
+  for (Lanes moved = ~Lanes{}; any(moved);) {
+    moved = Lanes{};
+
+    for (size_t y = H - 1; y > 0; --y) {
+      Lanes &below = m_cells[x + y * W];
+      Lanes &above = m_cells[x + (y - 1) * W];
+
+      const Lanes fall = (Lanes)(below == 0);
+      moved |= fall & (Lanes)(above != 0);
+      below |= above & fall;
+      above &= ~fall;
+    }
+  }
+}
+
+// NOTE: As in BasicSameGame, this needs to be called after the gravity, so
+// that a column is empty exactly when its bottom cell is.
+template <size_t W, size_t H, int C>
+void BasicPlayoutBatch<W, H, C>::stack_columns() {
+  const Lanes *bottom = &m_cells[(H - 1) * W];
+
+  for (bool moved = true; moved;) {
+    moved = false;
+
+    for (size_t x = 0; x + 1 < W; ++x) {
+      const Lanes slide =
+          (Lanes)(bottom[x] == 0) & (Lanes)(bottom[x + 1] != 0);
+      if (not any(slide)) {
+        continue;
+      }
+      moved = true;
+
+      for (size_t y = 0; y < H; ++y) {
+        Lanes &column = m_cells[x + y * W];
+        Lanes &next = m_cells[x + 1 + y * W];
+        column |= next & slide;
+        next &= ~slide;
+      }
+    }
+  }
+}
+
+template class BasicPlayoutBatch<WIDTH, HEIGHT, NB_COLORS>;
+template class BasicPlayoutBatch<20, 20, NB_COLORS>;
@@ -0,0 +1,158 @@
+#ifndef PLAYOUT_BATCH_H_
+#define PLAYOUT_BATCH_H_
+
+#include "types.h"
+#include "samegame.h"
+
+#include <array>
+#include <cstdint>
+#include <random>
+#include <type_traits>
+#include <vector>
+
+/**
+ * Runs playouts on LANES independent boards at once.
+ *
+ * The boards are stored structure-of-arrays: every cell is a vector holding
+ * its value in each lane, so that each step of a playout is a sequence of
+ * vector instructions over all the boards. The clusters are found by
+ * propagating the lowest rank of their members, see
+ * BasicSameGame::rep_rank(), so the moves are the actions a BasicSameGame
+ * would take.
+ *
+ * Every lane is played until it has no valid action left, the lanes which
+ * are done simply not moving anymore.
+ */
+template <size_t W, size_t H, int C> class BasicPlayoutBatch {
+public:
+  using Game = BasicSameGame<W, H, C>;
+
+  /**
+   * Type of the values of a lane: colors, labels, cell indices and counts.
+   * They fit on a byte on the smaller boards, which doubles the lanes.
+   */
+  using Value = std::conditional_t<(W * H < 0xfe), uint8_t, uint16_t>;
+
+  // Size of a vector register.
+#ifdef __AVX2__
+  static constexpr size_t VECTOR_SIZE = 32;
+#else
+  static constexpr size_t VECTOR_SIZE = 16;
+#endif
+
+  static constexpr size_t LANES = VECTOR_SIZE / sizeof(Value);
+
+  enum class Policy {
+    Random, // Uniformly among the valid actions
+    Greedy  // The largest cluster, the lowest index on ties
+  };
+
+  explicit BasicPlayoutBatch(unsigned seed = std::random_device{}());
+
+  /**
+   * Empty all the lanes.
+   */
+  void clear();
+
+  /**
+   * Copy the current board of `sg` into a lane.
+   */
+  void load(size_t lane, const Game &sg);
+
+  /**
+   * Play every lane to the end with the given policy.
+   */
+  void run(Policy policy);
+
+  /**
+   * Score of the last playout of a lane.
+   */
+  double score(size_t lane) const { return m_scores[lane]; }
+
+  /**
+   * Number of moves of the last playout of a lane.
+   */
+  int n_moves(size_t lane) const { return m_n_moves[lane]; }
+
+  /**
+   * Move k of the last playout of a lane.
+   */
+  Action move(size_t lane, int k) const { return Action{m_moves[k][lane]}; }
+
+private:
+  /**
+   * One value per lane, with the vector extension of GCC and Clang. Masks
+   * have all the bits set in the lanes where they hold, and none elsewhere.
+   */
+  typedef uint8_t Lanes8 __attribute__((vector_size(VECTOR_SIZE)));
+  typedef uint16_t Lanes16 __attribute__((vector_size(VECTOR_SIZE)));
+  using Lanes = std::conditional_t<sizeof(Value) == 1, Lanes8, Lanes16>;
+
+  static constexpr size_t N_CELLS = W * H;
+
+  // Label of the empty cells.
+  static constexpr Value NONE = Value(-1);
+  // Label of no cell, picked by the lanes which are done.
+  static constexpr Value NOTHING = Value(-2);
+
+  static_assert(N_CELLS < NOTHING);
+
+  // Color of each cell, 0 being the empty cell.
+  std::array<Lanes, N_CELLS> m_cells;
+  // Lowest rank of the cluster of each cell, or NONE.
+  std::array<Lanes, N_CELLS> m_labels;
+  // Masks of the lanes where a cell has the same color as its left and
+  // upper neighbours.
+  std::array<Lanes, N_CELLS> m_same_left;
+  std::array<Lanes, N_CELLS> m_same_up;
+  // Mask of the lanes where a cell represents a cluster of at least two
+  // cells.
+  std::array<Lanes, N_CELLS> m_valid;
+  // Size of the cluster of each rank, for the greedy policy.
+  std::array<Lanes, N_CELLS> m_sizes;
+
+  // Rank of each cell, between 0 and N_CELLS - 1.
+  std::array<Value, N_CELLS> m_ranks;
+
+  // Index of the first cell of the highest row which is not empty in every
+  // lane. The cells above it are left out of all the passes.
+  size_t m_first;
+
+  std::array<double, LANES> m_scores;
+  std::array<int, LANES> m_n_moves;
+  std::array<int, LANES> m_n_cells;
+  // The moves of the lanes, one row per step.
+  std::vector<Lanes> m_moves;
+
+  std::mt19937 m_gen;
+
+  /**
+   * Label every cell with the lowest rank of its cluster, after updating
+   * `m_first`.
+   */
+  void label();
+
+  /**
+   * Choose the action of every lane, by the index of its representative,
+   * setting `picks` to its label or NOTHING for the lanes which are done.
+   *
+   * @Return false if every lane is done.
+   */
+  bool pick(Policy policy, Lanes &actions, Lanes &picks);
+
+  /**
+   * Empty the cells labeled `picks`, setting `sizes` to the number of cells
+   * removed in each lane, then let the cells fall and the columns slide.
+   */
+  void remove(const Lanes &picks, Lanes &sizes);
+
+  void gravity(size_t x);
+  void stack_columns();
+};
+
+using PlayoutBatch = BasicPlayoutBatch<WIDTH, HEIGHT, NB_COLORS>;
+
+extern template class BasicPlayoutBatch<WIDTH, HEIGHT, NB_COLORS>;
+extern template class BasicPlayoutBatch<20, 20, NB_COLORS>;
+
+#endif // PLAYOUT_BATCH_H_
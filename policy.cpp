@@ -1,53 +1,194 @@
 #include "policy.h"
+#include "bounds.h"
 
 #include <algorithm>
 #include <array>
 #include <cassert>
 #include <random>
 
-std::pair<bool, Action> PolicyRandom::operator()(const SameGame &sg) {
-  m_buffer.clear();
-  sg.valid_actions(std::back_inserter(m_buffer));
+PolicyNMCS::PolicyNMCS(int level) : PolicyNMCS(level, std::random_device{}()) {}
 
-  if (m_buffer.empty()) {
-    return std::make_pair(false, Action{-1});
-  }
+PolicyNMCS::PolicyNMCS(int level, unsigned seed)
+    : m_level{level}, m_best{-1.0, {}}, m_expected_hash{0},
+      m_playout_policy{seed}, m_playouts{seed} {
+  assert(level > 0);
+
+  const size_t max_moves = WIDTH * HEIGHT / 2;
 
-  return std::make_pair(
-      true,
-      m_buffer[std::uniform_int_distribution<>(0, m_buffer.size() - 1)(gen)]);
+  m_games.reserve(level + 1);
+  for (int l = 0; l <= level; ++l) {
+    m_games.emplace_back(WIDTH, HEIGHT);
+    m_played.push_back(Sequence{0.0, {}});
+    m_played.back().moves.reserve(max_moves);
+    m_children.push_back(Sequence{0.0, {}});
+    m_children.back().moves.reserve(max_moves);
+    m_moves.emplace_back().reserve(max_moves);
+  }
+  m_best.moves.reserve(max_moves);
 }
 
-std::pair<bool, Action> PolicyGreedy::operator()(const SameGame &sg) {
-  m_buffer.clear();
-  sg.valid_actions(std::back_inserter(m_buffer));
+std::pair<bool, Action> PolicyNMCS::operator()(const SameGame &sg) {
+  // Forget the memorized sequence if we are not where it leads.
+  if (sg.hash() != m_expected_hash) {
+    m_best.score = -1.0;
+    m_best.moves.clear();
+  }
 
-  if (m_buffer.empty()) {
+  SameGame &root = m_games[m_level];
+  root.set_state(sg.state());
+  step(root, m_level, Sequence{0.0, {}}, m_best);
+
+  if (m_best.moves.empty()) {
     return std::make_pair(false, Action{-1});
   }
 
-  auto Cmp = [&sg](const auto &a, const auto &b) {
-    return sg.score(a) < sg.score(b);
-  };
+  const Action action = m_best.moves.front();
+  m_best.score -= root.score(action);
+  m_best.moves.erase(m_best.moves.begin());
+
+  root.apply(action);
+  m_expected_hash = root.hash();
+
+  return std::make_pair(true, action);
+}
 
-  return std::make_pair(
-      true, *std::max_element(m_buffer.begin(), m_buffer.end(), Cmp));
+void PolicyNMCS::set_incumbent(const SameGame &sg, double score,
+                               const std::vector<Action> &moves) {
+  m_best.score = score;
+  m_best.moves.assign(moves.begin(), moves.end());
+  m_expected_hash = sg.hash();
 }
 
-std::pair<bool, Action> PolicyLowColorCount::operator()(const SameGame &sg) {
-  m_buffer.clear();
-  sg.valid_actions(std::back_inserter(m_buffer));
+void PolicyNMCS::nested(const SameGame::State &state, int level,
+                        Sequence &best) {
+  SameGame &sg = m_games[level];
+  sg.set_state(state);
 
-  if (m_buffer.empty()) {
-    return std::make_pair(false, Action{-1});
+  best.score = 0.0;
+  best.moves.clear();
+
+  if (level == 0) {
+    while (true) {
+      auto [okay, action] = m_playout_policy(sg);
+      if (not okay) {
+        break;
+      }
+      best.score += sg.score(action);
+      best.moves.push_back(action);
+      sg.apply(action);
+    }
+    return;
+  }
+
+  Sequence &played = m_played[level];
+  played.score = 0.0;
+  played.moves.clear();
+
+  // Any sequence beats the initial one
+  best.score = -1.0;
+
+  // Follow the best sequence until the end of the game, which is reached
+  // when it has been played entirely.
+  while (true) {
+    step(sg, level, played, best);
+
+    // The best sequence is the one found so far, which is complete.
+    if (m_deadline.expired()) {
+      return;
+    }
+
+    if (played.moves.size() == best.moves.size()) {
+      break;
+    }
+
+    const Action action = best.moves[played.moves.size()];
+    played.score += sg.score(action);
+    played.moves.push_back(action);
+    sg.apply(action);
   }
 
-  auto Cmp = [&sg](const auto &a, const auto &b) {
-    const Color a_color = sg.get_color(a.index);
-    const Color b_color = sg.get_color(b.index);
-    return sg.get_color_count(a_color) < sg.get_color_count(b_color);
+  best.score = played.score;
+}
+
+void PolicyNMCS::step(SameGame &sg, int level, const Sequence &prefix,
+                      Sequence &best) {
+  std::vector<Move> &moves = m_moves[level];
+  moves.clear();
+  sg.moves(std::back_inserter(moves));
+
+  // Skip the moves after which even the upper bound cannot beat `best`.
+  auto hopeless = [&](const Move &move) {
+    return prefix.score + move.score + Bounds::upper_bound(sg, move) <=
+           best.score;
   };
+  moves.erase(std::remove_if(moves.begin(), moves.end(), hopeless),
+              moves.end());
+
+  if (level == 1) {
+    step_playouts(sg, moves, prefix, best);
+    return;
+  }
+
+  Sequence &child = m_children[level];
+
+  for (const Move &move : moves) {
+    // The best sequence may have improved since the moves were filtered.
+    if (hopeless(move)) {
+      continue;
+    }
+
+    const Action &action = move.action;
+    const double score = move.score;
+    sg.apply(action);
+    nested(sg.state(), level - 1, child);
+    sg.undo();
 
-  return std::make_pair(
-      true, *std::min_element(m_buffer.begin(), m_buffer.end(), Cmp));
+    // The child search may have been cut short.
+    if (m_deadline.expired()) {
+      return;
+    }
+
+    if (const double total = prefix.score + score + child.score;
+        total > best.score) {
+      best.score = total;
+      best.moves.assign(prefix.moves.begin(), prefix.moves.end());
+      best.moves.push_back(action);
+      best.moves.insert(best.moves.end(), child.moves.begin(),
+                        child.moves.end());
+    }
+  }
+}
+
+void PolicyNMCS::step_playouts(SameGame &sg, const std::vector<Move> &moves,
+                               const Sequence &prefix, Sequence &best) {
+  for (size_t first = 0; first < moves.size();
+       first += PlayoutBatch::LANES) {
+    if (m_deadline.expired()) {
+      return;
+    }
+
+    const size_t n = std::min(PlayoutBatch::LANES, moves.size() - first);
+
+    m_playouts.clear();
+    for (size_t l = 0; l < n; ++l) {
+      sg.apply(moves[first + l].action);
+      m_playouts.load(l, sg);
+      sg.undo();
+    }
+    m_playouts.run(PlayoutBatch::Policy::Random);
+
+    for (size_t l = 0; l < n; ++l) {
+      const Move &move = moves[first + l];
+
+      if (const double total = prefix.score + move.score + m_playouts.score(l);
+          total > best.score) {
+        best.score = total;
+        best.moves.assign(prefix.moves.begin(), prefix.moves.end());
+        best.moves.push_back(move.action);
+        for (int k = 0; k < m_playouts.n_moves(l); ++k) {
+          best.moves.push_back(m_playouts.move(l, k));
+        }
+      }
+    }
+  }
 }
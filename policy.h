@@ -1,20 +1,23 @@
 #ifndef POLICY_H_
 #define POLICY_H_
 
+#include <algorithm>
+#include <iterator>
 #include <random>
 #include <vector>
 
+#include "deadline.h"
 #include "samegame.h"
+#include "playout_batch.h"
 
 class PolicyRandom {
 public:
   PolicyRandom() = default;
+  explicit PolicyRandom(unsigned seed) : gen{seed} {}
 
-  std::pair<bool, Action> operator()(const SameGame &sg);
+  template <typename Game> std::pair<bool, Action> operator()(const Game &sg);
 
 private:
-  std::vector<Action> m_buffer;
-  std::vector<double> m_scores;
   std::mt19937 gen{std::random_device{}()};
 };
 
@@ -22,23 +25,160 @@ class PolicyGreedy {
 public:
   PolicyGreedy() = default;
 
-  std::pair<bool, Action> operator()(const SameGame& sg);
-
-private:
-  std::vector<Action> m_buffer;
-  std::vector<double> m_scores;
+  template <typename Game> std::pair<bool, Action> operator()(const Game &sg);
 };
 
 class PolicyLowColorCount {
 public:
   PolicyLowColorCount() = default;
 
-  std::pair<bool, Action> operator()(const SameGame& sg);
+  template <typename Game> std::pair<bool, Action> operator()(const Game &sg);
+};
+
+// The policies below pick directly from the cluster list of the game.
+
+template <typename Game>
+std::pair<bool, Action> PolicyRandom::operator()(const Game &sg) {
+  const std::vector<ClusterInfo> &clusters = sg.clusters();
+
+  if (clusters.empty()) {
+    return std::make_pair(false, Action{-1});
+  }
+
+  const int k = std::uniform_int_distribution<>(0, clusters.size() - 1)(gen);
+  return std::make_pair(true, Action{clusters[k].rep});
+}
+
+template <typename Game>
+std::pair<bool, Action> PolicyGreedy::operator()(const Game &sg) {
+  const std::vector<ClusterInfo> &clusters = sg.clusters();
+
+  if (clusters.empty()) {
+    return std::make_pair(false, Action{-1});
+  }
+
+  // The score only grows with the size of the cluster.
+  auto Cmp = [](const ClusterInfo &a, const ClusterInfo &b) {
+    return a.size < b.size;
+  };
+
+  const auto best = std::max_element(clusters.begin(), clusters.end(), Cmp);
+  return std::make_pair(true, Action{best->rep});
+}
+
+template <typename Game>
+std::pair<bool, Action> PolicyLowColorCount::operator()(const Game &sg) {
+  const std::vector<ClusterInfo> &clusters = sg.clusters();
+
+  if (clusters.empty()) {
+    return std::make_pair(false, Action{-1});
+  }
+
+  auto Cmp = [&sg](const ClusterInfo &a, const ClusterInfo &b) {
+    return sg.get_color_count(a.color) < sg.get_color_count(b.color);
+  };
+
+  const auto best = std::min_element(clusters.begin(), clusters.end(), Cmp);
+  return std::make_pair(true, Action{best->rep});
+}
+
+/**
+ * Nested Monte Carlo Search.
+ *
+ * At nesting level n, every valid action is tried and followed by a level
+ * n - 1 search, the best sequence found so far is memorized and its next
+ * move is played. Level 0 is a random playout, the playouts following the
+ * actions of a level 1 step being run together on a #PlayoutBatch.
+ *
+ * The actions which cannot lead to a better sequence than the best one,
+ * according to Bounds::upper_bound(), are not searched.
+ *
+ * Once the deadline given to #set_deadline() expires, the searches return
+ * the best sequence found until then, which always runs until the end of
+ * the game. The clock is read before each batch of playouts and each
+ * nested search, so that a search does not overrun its deadline by more
+ * than one batch of playouts.
+ */
+class PolicyNMCS {
+public:
+  struct Sequence {
+    double score;
+    std::vector<Action> moves;
+  };
+
+  explicit PolicyNMCS(int level = 1);
+  PolicyNMCS(int level, unsigned seed);
+
+  std::pair<bool, Action> operator()(const SameGame &sg);
+
+  /**
+   * Run a search of level at most the one given at construction.
+   *
+   * @Param state  The starting position.
+   * @Param level  The nesting level, 0 meaning a single playout.
+   * @Param best  Receives the best sequence found, scored from `state`.
+   */
+  void search(const SameGame::State &state, int level, Sequence &best) {
+    nested(state, level, best);
+  }
+
+  /**
+   * Limit the time of the following searches. `best` is left empty, with a
+   * negative score, by a search whose deadline expires before its first
+   * playout.
+   */
+  void set_deadline(const Deadline &deadline) { m_deadline = deadline; }
+
+  /**
+   * Start from a known line of the position of `sg`, which is only left
+   * for a better one.
+   *
+   * @Param score  The score of the line, from `sg`.
+   */
+  void set_incumbent(const SameGame &sg, double score,
+                     const std::vector<Action> &moves);
 
 private:
-  std::vector<Action> m_buffer;
-  std::vector<double> m_scores;
-  std::array<int, NB_COLORS> m_ccounter;
+  int m_level;
+  Deadline m_deadline;
+
+  // Best sequence found from the position expected at the next call.
+  Sequence m_best;
+  uint64_t m_expected_hash;
+
+  // Scratch boards and buffers, one per nesting level.
+  std::vector<SameGame> m_games;
+  std::vector<Sequence> m_played;
+  std::vector<Sequence> m_children;
+  std::vector<std::vector<Move>> m_moves;
+
+  PolicyRandom m_playout_policy;
+  PlayoutBatch m_playouts;
+
+  /**
+   * Run a level `level` search from a position.
+   *
+   * @Param state  The starting position.
+   * @Param level  The nesting level, 0 meaning a single playout.
+   * @Param best  Receives the best sequence found, scored from `state`.
+   */
+  void nested(const SameGame::State &state, int level, Sequence &best);
+
+  /**
+   * Try every valid action of `sg` followed by a level `level - 1` search,
+   * updating `best` whenever a sequence beats it.
+   *
+   * @Param sg  The current position, which is left unchanged.
+   * @Param prefix  The moves which led to `sg`, and their score.
+   */
+  void step(SameGame &sg, int level, const Sequence &prefix, Sequence &best);
+
+  /**
+   * Same as #step() at level 1, following each of the `moves` of `sg` by a
+   * playout on `m_playouts`.
+   */
+  void step_playouts(SameGame &sg, const std::vector<Move> &moves,
+                     const Sequence &prefix, Sequence &best);
 };
 
 
@@ -1,71 +1,69 @@
+#ifndef SG_BITBOARD
+
 #include "samegame.h"
+#include "bits.h"
+#include "board_io.h"
+#include "stats.h"
 
 #include <algorithm>
 #include <cassert>
-#include <deque>
 #include <iostream>
-#include <string>
+#include <stdexcept>
 #include <vector>
 
 
-SameGame::SameGame(size_t width, size_t height)
-    : m_width{width}, m_height{height}, m_data{width * height}, ccount{},
-      n_empty_rows{0} {
-  gravity_buffer.resize(width * height, Color::Empty);
-  members_buffer.reserve(width * height);
+template <size_t W, size_t H, int C>
+BasicSameGame<W, H, C>::BasicSameGame()
+    : ccount{}, m_hash{0},
+      n_empty_rows{0}, m_dirty_begin{0}, m_dirty_end{W}, m_n_detached{0} {
+  m_columns.fill(0);
+  m_detached.fill(false);
+  m_clusters.reserve(W * H / 2);
+  m_history.reserve(W * H / 2);
+  m_cluster_index.fill(-1);
   ccount.fill(0);
 }
 
 
-void SameGame::load(std::istream &is) {
-  m_data.reset();
-  n_empty_rows = 0;
-
-  std::string buf;
-  std::string buf_ss;
-  for (auto y = 0; y < m_height; ++y) {
-    std::getline(is, buf);
-    std::string_view sv = buf;
-
-    bool row_empty = true;
-    auto x = 0;
-    for (; x < m_width; ++x) {
-      size_t pspace = std::min(sv.find(' '), sv.size());
-      buf_ss = std::string(pspace, '\0');
-      sv.copy(&buf_ss[0], pspace, 0);
-      sv.remove_prefix(pspace + 1);
-
-      int color_i = std::stoi(buf_ss) + 1;
-      ++ccount[color_i];
-
-      Cluster &cluster = m_data[x + y * m_width];
-      const Color color = cluster.color = Color(color_i);
-      const int rep = cluster.rep =
-          cluster.color == Color::Empty ? -1 : x + y * m_width;
-      row_empty &= rep == -1;
-    }
+template <size_t W, size_t H, int C>
+void BasicSameGame<W, H, C>::load(std::istream &is) {
+  Board board;
+  if (not BoardIO::read(is, board, C)) {
+    throw std::runtime_error("Invalid board");
+  }
+  load(board);
+}
 
-    n_empty_rows += row_empty;
+template <size_t W, size_t H, int C>
+void BasicSameGame<W, H, C>::load(const Board &board) {
+  State state;
+  state.cells = board;
+  state.ccount.fill(0);
+  for (const Color color : board) {
+    ++state.ccount[static_cast<std::underlying_type_t<Color>>(color)];
   }
-  compute_clusters();
+  set_state(state);
 }
 
-void SameGame::compute_clusters() {
+template <size_t W, size_t H, int C>
+void BasicSameGame<W, H, C>::compute_clusters() {
+  SG_STATS_TIMER(ComputeClusters);
+
   m_data.reset();
 
   // Loop from the bottom row upwards
-  int y = m_height - 1;
+  int y = H - 1;
   bool row_empty;
 
-  for (; y >= 0; --y) {
+  for (; y > 0; --y) {
     row_empty = true;
 
     // Loop from the leftmost to the second to rightmost column
-    int i = y * m_width;
-    for (; i < (y + 1) * m_width - 1; ++i) {
+    int i = y * W;
+    for (; i < (y + 1) * W - 1; ++i) {
 
       // Skip empty cells
-      if (m_data[i].color == Color::Empty) {
+      if (m_data.color(i) == Color::Empty) {
         continue;
       }
 
@@ -73,24 +71,24 @@ void SameGame::compute_clusters() {
       row_empty = false;
 
       // Compare up
-      if (m_data[i].color == m_data[i - m_width].color)
-        m_data.unite(i, i - m_width);
+      if (m_data.color(i) == m_data.color(i - W))
+        m_data.unite(i, i - W);
 
       // Compare right
-      if (m_data[i].color == m_data[i + 1].color)
+      if (m_data.color(i) == m_data.color(i + 1))
         m_data.unite(i, i + 1);
     }
 
     // At rightmost column,
     // if cell is empty,
-    if (m_data[i].color == Color::Empty) {
+    if (m_data.color(i) == Color::Empty) {
       // if the row is empty, update n_empty_rows
       n_empty_rows = row_empty * std::max(n_empty_rows, y);
     }
 
     // Otherwise compare up.
-    else if (m_data[i].color == m_data[i - m_width].color) {
-      m_data.unite(i, i - m_width);
+    else if (m_data.color(i) == m_data.color(i - W)) {
+      m_data.unite(i, i - W);
     }
   }
 
@@ -98,10 +96,10 @@ void SameGame::compute_clusters() {
   // to the second to rightmost column
   int i = 0;
   row_empty = true;
-  for (; i < m_width - 1; ++i) {
+  for (; i < W - 1; ++i) {
 
     // Skip empty cells
-    if (m_data[i].color == Color::Empty) {
+    if (m_data.color(i) == Color::Empty) {
       continue;
     }
 
@@ -109,146 +107,328 @@ void SameGame::compute_clusters() {
     row_empty = false;
 
     // Compare right
-    if (m_data[i].color == m_data[i + 1].color)
+    if (m_data.color(i) == m_data.color(i + 1))
       m_data.unite(i, i + 1);
   }
 
   // After traversing the topmost row, check if n_empty_rows is
   // 0 or 1.
-  row_empty &= m_data[i].color == Color::Empty;
+  row_empty &= m_data.color(i) == Color::Empty;
   n_empty_rows = row_empty * std::max(n_empty_rows, 1);
+
+  for (const ClusterInfo &cluster : m_clusters) {
+    m_cluster_index[cluster.rep] = -1;
+  }
+  m_clusters.clear();
+  for (int i = 0; i < W * H; ++i) {
+    list_cluster(i);
+  }
 }
 
-void SameGame::gravity() {
-  // Reset the buffer
-  std::fill(gravity_buffer.begin(), gravity_buffer.end(), Color::Empty);
+template <size_t W, size_t H, int C>
+void BasicSameGame<W, H, C>::list_cluster(int i) {
+  const Cluster cluster = m_data.cluster(i);
+  if (cluster.rep == i && m_cluster_index[i] < 0 &&
+      cluster.color != Color::Empty && cluster.size() > 1) {
+    m_cluster_index[i] = m_clusters.size();
+    m_clusters.push_back(
+        ClusterInfo{i, static_cast<int>(cluster.size()), cluster.color});
+  }
+}
 
-  // Loop through all columns
-  for (int x = 0; x < m_width; ++x) {
-    // Set up a fresh column for the output buffer
-    auto out = gravity_buffer.begin() + x * m_height;
+template <size_t W, size_t H, int C>
+void BasicSameGame<W, H, C>::unlist_cluster(int i) {
+  if (const int k = m_cluster_index[i]; k >= 0) {
+    m_cluster_index[m_clusters.back().rep] = k;
+    m_clusters[k] = m_clusters.back();
+    m_clusters.pop_back();
+    m_cluster_index[i] = -1;
+  }
+}
 
-    // From the bottommost to the upmost cell in the column,
-    for (int y = m_height - 1; y >= 0; --y) {
-      // Copy the non-empty cells into the buffer
-      if (Color color = m_data[x + y * m_width].color; color != Color::Empty) {
-        *out++ = color;
-      }
-    }
+namespace {
 
-    // Copy the collected nonempty colors back into the column
-    int h = 0;
-    size_t n = m_height;
+/**
+ * The lowest bit of each cell of a packed column of height h.
+ */
+template <size_t H, int CELL_BITS>
+constexpr uint64_t cell_lsbs =
+    Bits::field_lsbs(CELL_BITS) &
+    ((uint64_t{1} << (CELL_BITS * H - 1) << 1) - 1);
 
-    for (size_t h = 0; h < m_height; ++h) {
-      m_data[x + (m_height - h - 1) * m_width].color =
-          gravity_buffer[x * m_height + h];
-    }
-  }
-}
+} // namespace
 
-// NOTE: We take advantage of the fact that #stack_columns() needs to be called
-// after #gravity(). Since no horizontal gap can exist in this context, it
-// suffices the check the bottom cell of a column to verify if the whole column
-// is empty.
-void SameGame::stack_columns() {
-  // Empty column predicate
-  auto is_empty_column = [&](auto x) {
-    return m_data[x + (m_height - 1) * m_width].color == Color::Empty;
-  };
+template <size_t W, size_t H, int C>
+void BasicSameGame<W, H, C>::gravity() {
+  SG_STATS_TIMER(Gravity);
+
+  constexpr uint64_t lsbs = cell_lsbs<H, CELL_BITS>;
 
-  std::deque<size_t> empty_cols;
+  // Only the dirty columns can have gaps
+  for (size_t x = m_dirty_begin; x < m_dirty_end; ++x) {
+    const uint64_t column = m_columns[x];
 
-  // Loop from the leftmost to the rightmost column
-  for (size_t col = 0; col < m_width; ++col) {
+    // All the bits of the non-empty cells of the column.
+    static_assert(CELL_BITS == 3);
+    const uint64_t occupied =
+        ((column | column >> 1 | column >> 2) & lsbs) * CELL_MASK;
 
-    // Store the index of empty columns as we find them
-    if (is_empty_column(col)) {
-      empty_cols.push_back(col);
+    // Nothing to do if the cells are already packed at the bottom.
+    if ((occupied & (occupied + 1)) == 0) {
       continue;
     }
 
-    // In case we have empty columns available on our left,
-    // swap the current (nonempty) column with the leftmost
-    // empty column
-    if (not empty_cols.empty()) {
-      for (int y = 0; y < m_height; ++y) {
-        std::swap(m_data[empty_cols.front() + y * m_width].color,
-                  m_data[col + y * m_width].color);
-      }
-      // Remove the newly filled column from the empty column queue.
-      empty_cols.pop_front();
-
-      // The current column is now the rightmost empty column known.
-      empty_cols.push_back(col);
-    }
+    m_columns[x] = Bits::compress(column, occupied);
+    unpack_column(x, column);
   }
 }
 
-const Cluster &SameGame::get_cluster(int i) const {
-  return m_data[m_data.find_rep(i)];
-}
+// NOTE: We take advantage of the fact that #stack_columns() needs to be called
+// after #gravity(). Since no horizontal gap can exist in this context, a column
+// is empty exactly when its packed word is zero.
+template <size_t W, size_t H, int C>
+void BasicSameGame<W, H, C>::stack_columns() {
+  SG_STATS_TIMER(StackColumns);
+
+  // Since the columns are always stacked, there is no empty column on the
+  // left of the dirty ones.
+  const auto first_empty =
+      std::find(m_columns.begin() + m_dirty_begin, m_columns.end(), 0);
+  if (first_empty == m_columns.end()) {
+    return;
+  }
 
-void SameGame::clear_cluster(int index) {
-  members_buffer.clear();
+  const std::array<uint64_t, W> old_columns = m_columns;
+  const auto last = std::remove(first_empty, m_columns.end(), 0);
+  std::fill(last, m_columns.end(), 0);
 
-  const std::vector<int> &_members = get_cluster(index).members;
-  std::copy(_members.begin(), _members.end(),
-            std::back_inserter(members_buffer));
+  for (size_t x = first_empty - m_columns.begin(); x < W; ++x) {
+    if (m_columns[x] != old_columns[x]) {
+      unpack_column(x, old_columns[x]);
 
-  std::for_each(members_buffer.begin(), members_buffer.end(),
-                [&](const auto i) {
-                  Color& color = m_data[i].color;
-                  --ccount[static_cast< std::underlying_type_t< Color > >(color)];
-                  ++ccount[static_cast< std::underlying_type_t< Color > >(Color::Empty)];
-                  m_data[i].color = Color::Empty;
-                  m_data[i].rep = i;
-                  m_data[i].members.clear();
-                });
+      // Every column on the right of the first gap has moved.
+      m_dirty_end = W;
+    }
+  }
 }
 
-namespace {
+template <size_t W, size_t H, int C>
+void BasicSameGame<W, H, C>::pack_columns() {
+  for (size_t x = 0; x < W; ++x) {
+    uint64_t column = 0;
+    for (size_t y = 0; y < H; ++y) {
+      const Color color = m_data.color(x + y * W);
+      column = column << CELL_BITS |
+               static_cast<std::underlying_type_t<Color>>(color);
+    }
+    m_columns[x] = column;
+  }
+}
 
-inline bool is_valid(const Action& action, const Cluster& cluster) {
-  return cluster.color != Color::Empty && cluster.rep == action.index &&
-    cluster.size() > 1;
+template <size_t W, size_t H, int C>
+void BasicSameGame<W, H, C>::unpack_column(size_t x, uint64_t old_column) {
+  uint64_t changed = old_column ^ m_columns[x];
+  changed = (changed | changed >> 1 | changed >> 2) & cell_lsbs<H, CELL_BITS>;
+
+  for (; changed; changed &= changed - 1) {
+    const int k = __builtin_ctzll(changed) / CELL_BITS;
+    const int i = x + (H - 1 - k) * W;
+    const Color color = Color(m_columns[x] >> (k * CELL_BITS) & CELL_MASK);
+    m_hash ^= Zobrist::key(i, m_data.color(i)) ^ Zobrist::key(i, color);
+    m_data.color(i) = color;
+  }
 }
 
-} // namespace
+template <size_t W, size_t H, int C>
+Cluster BasicSameGame<W, H, C>::get_cluster(int i) const {
+  return m_data.cluster(i);
+}
 
+template <size_t W, size_t H, int C>
+void BasicSameGame<W, H, C>::clear_cluster(int index) {
+  SG_STATS_TIMER(ClearCluster);
 
-bool SameGame::is_valid(const Action &action) const {
-  return ::is_valid(action, m_data[action.index]);
-}
+  const Cluster cluster = get_cluster(index);
+  unlist_cluster(cluster.rep);
 
-double SameGame::score(const Action& action) const {
-  auto bonus_predicate = [&](const Cluster& cluster) {
-    const size_t n_empty_cells = ccount[0];
-    return n_empty_cells + cluster.size() == m_data.size();
-  };
+  m_dirty_begin = W;
+  m_dirty_end = 0;
 
-  const Cluster& cluster = get_cluster(action.index);
-  const size_t sz = cluster.size();
+  // The iterator moves on before each member is detached from the others.
+  for (auto it = cluster.begin(); it != cluster.end();) {
+    const int i = *it++;
 
-  double score = ::is_valid(action, cluster) * (
-    (sz - 2) * (sz - 2) + 1000.0 * bonus_predicate(cluster));
+    m_dirty_begin = std::min<size_t>(m_dirty_begin, i % W);
+    m_dirty_end = std::max<size_t>(m_dirty_end, i % W + 1);
 
-  return score;
+    Color &color = m_data.color(i);
+    m_hash ^= Zobrist::key(i, color);
+    --ccount[static_cast<std::underlying_type_t<Color>>(color)];
+    ++ccount[static_cast<std::underlying_type_t<Color>>(Color::Empty)];
+    color = Color::Empty;
+    m_data.reset(i);
+    m_columns[i % W] &= ~(CELL_MASK << (CELL_BITS * (H - 1 - i / W)));
+  }
 }
 
-void SameGame::apply(const Action &action) {
+template <size_t W, size_t H, int C>
+void BasicSameGame<W, H, C>::apply(const Action &action) {
 
   if (not is_valid(action)) {
     std::cerr << "Invalid action: " << action.index << std::endl;
     throw std::runtime_error("Invalid action");
   }
 
+  Undo &undo = m_history.emplace_back();
+  undo.state = state();
+  undo.hash = m_hash;
+  undo.columns = m_columns;
+
   clear_cluster(action.index);
   gravity();
   stack_columns();
+  update_clusters();
+
+  undo.dirty_begin = m_dirty_begin;
+  undo.dirty_end = m_dirty_end;
+}
+
+// NOTE: The cells outside of the dirty columns of a move are the same before
+// and after it, so #update_clusters() works just as well backwards.
+template <size_t W, size_t H, int C>
+void BasicSameGame<W, H, C>::undo() {
+  assert(not m_history.empty());
+  const Undo &undo = m_history.back();
+
+  for (int i = 0; i < m_data.size(); ++i) {
+    m_data.color(i) = undo.state.cells[i];
+  }
+  m_columns = undo.columns;
+  ccount = undo.state.ccount;
+  m_hash = undo.hash;
+
+  m_dirty_begin = undo.dirty_begin;
+  m_dirty_end = undo.dirty_end;
+  update_clusters();
+
+  m_history.pop_back();
+}
+
+template <size_t W, size_t H, int C>
+auto BasicSameGame<W, H, C>::state() const -> State {
+
+  State state;
+  for (int i = 0; i < m_data.size(); ++i) {
+    state.cells[i] = m_data.color(i);
+  }
+  state.ccount = ccount;
+  return state;
+}
+
+template <size_t W, size_t H, int C>
+void BasicSameGame<W, H, C>::set_state(const State &state) {
+  for (int i = 0; i < m_data.size(); ++i) {
+    m_data.color(i) = state.cells[i];
+  }
+  pack_columns();
+  ccount = state.ccount;
+  m_history.clear();
+  rehash();
   compute_clusters();
 }
 
-int SameGame::get_color_count(Color c) const {
+template <size_t W, size_t H, int C>
+void BasicSameGame<W, H, C>::rehash() {
+  m_hash = 0;
+  for (int i = 0; i < m_data.size(); ++i) {
+    m_hash ^= Zobrist::key(i, m_data.color(i));
+  }
+}
+
+// NOTE: Neither #gravity() nor #stack_columns() touch the DSU links, they only
+// move colors around. So when we get here, `m_data` still holds the clusters as
+// they were before the move. Those which lie entirely outside of the dirty
+// columns have kept both their cells and their colors, so they are still
+// correct and only need to be merged with their new neighbours.
+//
+// The listed clusters follow along: the detached ones are unlisted, as is any
+// cluster about to grow by a merge, and the clusters of the detached cells are
+// listed again once complete.
+template <size_t W, size_t H, int C>
+void BasicSameGame<W, H, C>::update_clusters() {
+  SG_STATS_TIMER(UpdateClusters);
+
+  m_n_detached = 0;
+
+  auto detach = [&](int i) {
+    if (not m_detached[i]) {
+      m_detached[i] = true;
+      m_detached_cells[m_n_detached++] = i;
+      unlist_cluster(i);
+      m_data.reset(i);
+    }
+  };
+
+  // Detach all cells of the dirty columns along with their former clusters.
+  for (int y = 0; y < H; ++y) {
+    for (int x = m_dirty_begin; x < m_dirty_end; ++x) {
+      const int i = x + y * W;
+      if (m_detached[i]) {
+        continue;
+      }
+
+      if (const Cluster cluster = get_cluster(i); cluster.size() > 1) {
+        // The iterator moves on before each member is detached.
+        for (auto it = cluster.begin(); it != cluster.end();) {
+          detach(*it++);
+        }
+      } else {
+        detach(i);
+      }
+    }
+  }
+
+  // Merge the detached cells with their neighbours of the same color.
+  for (size_t k = 0; k < m_n_detached; ++k) {
+    const int i = m_detached_cells[k];
+    m_detached[i] = false;
+
+    const Color color = m_data.color(i);
+    if (color == Color::Empty) {
+      continue;
+    }
+
+    const int x = i % W;
+    const int y = i / W;
+
+    auto merge = [&](int j) {
+      if (m_data.color(j) == color) {
+        unlist_cluster(m_data.find_rep(j));
+        m_data.unite(i, j);
+      }
+    };
+
+    if (x > 0)
+      merge(i - 1);
+    if (x < W - 1)
+      merge(i + 1);
+    if (y > 0)
+      merge(i - W);
+    if (y < H - 1)
+      merge(i + W);
+  }
+
+  for (size_t k = 0; k < m_n_detached; ++k) {
+    list_cluster(m_data.find_rep(m_detached_cells[k]));
+  }
+}
+
+template <size_t W, size_t H, int C>
+int BasicSameGame<W, H, C>::get_color_count(Color c) const {
   return ccount[static_cast<std::underlying_type_t<Color>>(c)];
 }
+
+template class BasicSameGame<WIDTH, HEIGHT, NB_COLORS>;
+template class BasicSameGame<20, 20, NB_COLORS>;
+
+#endif // SG_BITBOARD
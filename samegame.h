@@ -4,35 +4,133 @@
 
 #include "types.h"
 #include "dsu.h"
+#include "zobrist.h"
+
+#ifdef SG_BITBOARD
+#include "bitboard.h"
+#endif
 
 #include <array>
 #include <iosfwd>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
 #include <vector>
 
 struct Action {
   int index;
 };
 
-class SameGame {
+/**
+ * A cluster of at least two cells, removed by playing its representative.
+ */
+struct ClusterInfo {
+  int rep;
+  int size;
+  Color color;
+};
+
+/**
+ * A valid action along with the cluster it removes and its score.
+ */
+struct Move {
+  Action action;
+  int size;
+  Color color;
+  double score;
+};
+
+/**
+ * A W x H board with C colors.
+ *
+ * The dimensions are template parameters so that the strides and loop
+ * bounds of the kernels are known at compile time. Only the shapes listed
+ * in #SameGames are instantiated, see dispatch() to pick one at runtime.
+ */
+template <size_t W, size_t H, int C> class BasicSameGame {
 public:
-  SameGame(size_t width, size_t height);
+  static_assert(W * H <= MAX_CELLS && C <= MAX_COLORS);
+
+  using Board = BasicBoard<W, H>;
+#ifdef SG_BITBOARD
+  using BitBoard = BasicBitBoard<W, H>;
+#endif
+
+  /**
+   * Compact snapshot of a board, cheap to copy around.
+   */
+  struct State {
+#ifdef SG_BITBOARD
+    std::array<BitBoard, C> masks;
+#else
+    Board cells;
+#endif
+    std::array<int, C + 1> ccount;
+  };
+
+  BasicSameGame();
 
   /**
-   * Load the board from an input stream.
+   * Throws std::invalid_argument unless the dimensions are W x H.
+   */
+  BasicSameGame(size_t width, size_t height);
+
+  /**
+   * Load the board from an input stream, see BoardIO::read().
    */
   void load(std::istream &is);
 
+  /**
+   * Load the board from the colors of its cells. The move history is
+   * cleared.
+   */
+  void load(const Board &board);
+
   /**
    * Apply a move by emptying the associated cluster of cells
    * and applying downwards and leftwards gravity.
    */
   void apply(const Action &action);
 
+  /**
+   * Take back the last move applied since the board was loaded, of which
+   * there must be one, see #n_moves().
+   */
+  void undo();
+
+  /**
+   * Number of moves which can be taken back with #undo().
+   */
+  size_t n_moves() const { return m_history.size(); }
+
+  /**
+   * Get a snapshot of the current board.
+   */
+  State state() const;
+
+  /**
+   * Restore the board from a snapshot. The move history is cleared.
+   */
+  void set_state(const State &state);
+
   /**
    * Get valid actions.
    */
   template <typename OutputIter> void valid_actions(OutputIter out) const;
 
+  /**
+   * The clusters of at least two cells, in no particular order. The list is
+   * kept up to date as moves are applied and taken back, so that the
+   * policies can go through it without scanning the board.
+   */
+  const std::vector<ClusterInfo> &clusters() const { return m_clusters; }
+
+  /**
+   * Get every valid action along with its cluster and score, in a single
+   * pass over #clusters().
+   */
+  template <typename OutputIter> void moves(OutputIter out) const;
+
   /**
    * Get the current count for each colors.
    */
@@ -40,9 +138,10 @@ public:
   void colour_counter(OutputIter out) const;
 
   /**
-   * Get the cluster containing the cell at index i.
+   * Get a view of the cluster containing the cell at index i, valid until
+   * the next move.
    */
-  const Cluster &get_cluster(int i) const;
+  Cluster get_cluster(int i) const;
 
   /**
    * Check if an action is valid in the current state.
@@ -54,6 +153,11 @@ public:
    */
   double score(const Action &action) const;
 
+  /**
+   * Score of removing a cluster of `size` cells from the current board.
+   */
+  double score_of(int size) const;
+
   /**
    * Get the color count for given color.
    */
@@ -62,27 +166,136 @@ public:
   /**
    * Get the color of the cell at index i.
    */
-  Color get_color(int i) const
-    { return m_data[i].color; }
+  Color get_color(int i) const;
 
-  size_t width() const { return m_width; }
-  size_t height() const { return m_height; }
+  /**
+   * Zobrist hash of the current board, see #Zobrist.
+   */
+  uint64_t hash() const { return m_hash; }
+
+  static constexpr size_t width() { return W; }
+  static constexpr size_t height() { return H; }
+  static constexpr int nb_colors() { return C; }
+
+  /**
+   * Rank of the cell at index i among the members of its cluster, the
+   * representative of a cluster being its member of lowest rank.
+   */
+  static constexpr int rep_rank(int i);
 
 
 private:
-  const size_t m_width;
-  const size_t m_height;
-  DSU m_data;
+  // Times the private steps of #apply(), see bench.cpp.
+  friend class Benchmark;
+
+  std::array<int, C + 1> ccount;
+  uint64_t m_hash;
+
+  /**
+   * What is needed to take a move back.
+   */
+  struct Undo {
+    State state;
+    uint64_t hash;
+#ifdef SG_BITBOARD
+    uint64_t dirty_columns;
+#else
+    std::array<uint64_t, W> columns;
+    size_t dirty_begin;
+    size_t dirty_end;
+#endif
+  };
+
+  // Boards before each move, the most recent one last.
+  std::vector<Undo> m_history;
+
+  std::vector<ClusterInfo> m_clusters;
+  // Index in `m_clusters` of the cluster represented by each cell, or -1.
+  std::array<int16_t, W * H> m_cluster_index;
+
+  /**
+   * Recompute the hash of the board from scratch.
+   */
+  void rehash();
+
+#ifdef SG_BITBOARD
+  // One mask per non-empty color, `m_masks[0]` holding the first color.
+  std::array<BitBoard, C> m_masks;
+  BitBoard m_occupied;
+
+  // The cells of each cluster of `m_clusters`, whose representative is the
+  // cell of its lowest bit.
+  std::vector<BitBoard> m_cluster_masks;
+  // Columns touched by the last call to #clear_cluster().
+  uint64_t m_dirty_columns;
 
-  std::array<int, NB_COLORS + 1> ccount;
+  // Links between the members of the result of #get_cluster().
+  mutable std::array<Cluster::Link, W * H> m_cluster_next;
+
+  /**
+   * Replace the content of column x of the color masks, keeping the hash
+   * up to date. `m_occupied` is left to the caller.
+   */
+  void set_column(size_t x, const std::array<uint64_t, C> &lanes);
+#else
+  BasicDSU<W * H> m_data;
   int n_empty_rows;
 
-  std::vector<Color> gravity_buffer;
-  std::vector<int> members_buffer;
+  // Columns in [m_dirty_begin, m_dirty_end) were modified by the last move.
+  size_t m_dirty_begin;
+  size_t m_dirty_end;
+
+  // Column-major copy of the colors, see #CELL_BITS.
+  std::array<uint64_t, W> m_columns;
+
+  // Cells detached by #update_clusters(), the first `m_n_detached` ones.
+  std::array<Cluster::Link, W * H> m_detached_cells;
+  size_t m_n_detached;
+  std::array<bool, W * H> m_detached;
+
+  /**
+   * Cells are packed in `m_columns` on CELL_BITS bits each, the bottom cell
+   * of column x in the lowest bits of `m_columns[x]`, so that gravity is a
+   * bit compression and stacking the columns a move of words.
+   */
+  static constexpr int CELL_BITS = 3;
+  static constexpr uint64_t CELL_MASK = (1 << CELL_BITS) - 1;
+
+  static_assert(C <= CELL_MASK && CELL_BITS * H <= 64,
+                "A column must fit in a single machine word");
+
+  /**
+   * Restore the clusters after a move, only relabeling the cells of
+   * the dirty columns and of the clusters which reached into them.
+   */
+  void update_clusters();
+
+  /**
+   * Add the cluster represented by cell i to `m_clusters` if it has at
+   * least two cells and is not listed yet.
+   */
+  void list_cluster(int i);
+
+  /**
+   * Remove the cluster represented by cell i from `m_clusters`, if listed.
+   */
+  void unlist_cluster(int i);
+
+  /**
+   * Rebuild `m_columns` from the colors of `m_data`.
+   */
+  void pack_columns();
+
+  /**
+   * Copy column x of `m_columns` into `m_data`, where it used to hold
+   * `old_column`, keeping the hash up to date.
+   */
+  void unpack_column(size_t x, uint64_t old_column);
+#endif
 
   /**
    * Organize the connected sets of cells of the same color
-   * into the #Cluster array of the member #DSU `m_data`.
+   * into the clusters of the member #DSU `m_data`.
    */
   void compute_clusters();
 
@@ -108,20 +321,99 @@ private:
   void clear_cluster(int index);
 };
 
+/**
+ * The instantiations of #BasicSameGame, from which dispatch() picks. They
+ * are explicitly instantiated in samegame.cpp and samegame_bitboard.cpp.
+ */
+using SameGames = std::tuple<BasicSameGame<WIDTH, HEIGHT, NB_COLORS>,
+                             BasicSameGame<20, 20, NB_COLORS>>;
+
+using SameGame = BasicSameGame<WIDTH, HEIGHT, NB_COLORS>;
+
+extern template class BasicSameGame<WIDTH, HEIGHT, NB_COLORS>;
+extern template class BasicSameGame<20, 20, NB_COLORS>;
+
+template <size_t W, size_t H, int C>
+BasicSameGame<W, H, C>::BasicSameGame(size_t width, size_t height)
+    : BasicSameGame() {
+  if (width != W || height != H) {
+    throw std::invalid_argument("Unexpected board dimensions");
+  }
+}
+
+template <size_t W, size_t H, int C>
 template <typename OutputIter>
-inline void SameGame::valid_actions(OutputIter out) const {
-  for (int i = 0; i < m_data.size(); ++i) {
-    if (auto action = Action{i}; is_valid(action)) {
-      out = action;
-    }
+inline void BasicSameGame<W, H, C>::valid_actions(OutputIter out) const {
+  for (const ClusterInfo &cluster : m_clusters) {
+    out = Action{cluster.rep};
   }
 }
 
-template< typename OutputIter >
-inline void SameGame::colour_counter(OutputIter out) const {
-  std::copy(ccount.begin(), ccount.end(), out);
+template <size_t W, size_t H, int C>
+template <typename OutputIter>
+inline void BasicSameGame<W, H, C>::moves(OutputIter out) const {
+  for (const ClusterInfo &cluster : m_clusters) {
+    out = Move{Action{cluster.rep}, cluster.size, cluster.color,
+               score_of(cluster.size)};
+  }
+}
+
+template <size_t W, size_t H, int C>
+inline bool BasicSameGame<W, H, C>::is_valid(const Action &action) const {
+  return action.index >= 0 && action.index < W * H &&
+         m_cluster_index[action.index] >= 0;
+}
+
+template <size_t W, size_t H, int C>
+inline double BasicSameGame<W, H, C>::score_of(int size) const {
+  const size_t n_empty_cells = ccount[0];
+  return (size - 2) * (size - 2) + 1000.0 * (n_empty_cells + size == W * H);
 }
 
+template <size_t W, size_t H, int C>
+inline double BasicSameGame<W, H, C>::score(const Action &action) const {
+  return is_valid(action)
+             ? score_of(m_clusters[m_cluster_index[action.index]].size)
+             : 0.0;
+}
+
+#ifdef SG_BITBOARD
+
+template <size_t W, size_t H, int C>
+constexpr int BasicSameGame<W, H, C>::rep_rank(int i) {
+  return BitBoard::bit_of(i);
+}
 
+template <size_t W, size_t H, int C>
+inline Color BasicSameGame<W, H, C>::get_color(int i) const {
+  const int b = BitBoard::bit_of(i);
+  for (int c = 0; c < C; ++c) {
+    if (m_masks[c].test(b))
+      return Color(c + 1);
+  }
+  return Color::Empty;
+}
+
+#else
+
+template <size_t W, size_t H, int C>
+constexpr int BasicSameGame<W, H, C>::rep_rank(int i) {
+  return i;
+}
+
+template <size_t W, size_t H, int C>
+inline Color BasicSameGame<W, H, C>::get_color(int i) const {
+  return m_data.color(i);
+}
+
+#endif
+
+static_assert(std::is_trivially_copyable_v<SameGame::State>);
+
+template <size_t W, size_t H, int C>
+template <typename OutputIter>
+inline void BasicSameGame<W, H, C>::colour_counter(OutputIter out) const {
+  std::copy(ccount.begin(), ccount.end(), out);
+}
 
 #endif // SAMEGAME_H_
@@ -0,0 +1,337 @@
+#ifdef SG_BITBOARD
+
+#include "samegame.h"
+#include "bits.h"
+#include "board_io.h"
+#include "stats.h"
+
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <stdexcept>
+
+namespace {
+
+/**
+ * Xor of the keys of the cells of column x selected by `bits`, for a color.
+ */
+template <typename BitBoard>
+inline uint64_t lane_keys(size_t x, uint64_t bits, Color color) {
+  uint64_t keys = 0;
+  for (; bits; bits &= bits - 1) {
+    keys ^= Zobrist::key(
+        BitBoard::index_of(x * BitBoard::LANE + __builtin_ctzll(bits)), color);
+  }
+  return keys;
+}
+
+template <size_t W>
+constexpr uint64_t all_columns = (uint64_t{1} << (W - 1) << 1) - 1;
+
+} // namespace
+
+template <size_t W, size_t H, int C>
+BasicSameGame<W, H, C>::BasicSameGame()
+    : ccount{}, m_hash{0}, m_masks{}, m_occupied{}, m_dirty_columns{0} {
+  static_assert(W <= 64, "Dirty columns are tracked in a single word");
+
+  m_clusters.reserve(W * H / 2);
+  m_history.reserve(W * H / 2);
+  m_cluster_masks.reserve(W * H / 2);
+  m_cluster_index.fill(-1);
+}
+
+template <size_t W, size_t H, int C>
+void BasicSameGame<W, H, C>::load(std::istream &is) {
+  Board board;
+  if (not BoardIO::read(is, board, C)) {
+    throw std::runtime_error("Invalid board");
+  }
+  load(board);
+}
+
+template <size_t W, size_t H, int C>
+void BasicSameGame<W, H, C>::load(const Board &board) {
+  State state{};
+  for (int i = 0; i < W * H; ++i) {
+    const auto color = static_cast<std::underlying_type_t<Color>>(board[i]);
+    ++state.ccount[color];
+    if (color != 0) {
+      state.masks[color - 1].set(BitBoard::bit_of(i));
+    }
+  }
+  set_state(state);
+}
+
+template <size_t W, size_t H, int C>
+void BasicSameGame<W, H, C>::rehash() {
+  m_hash = 0;
+  for (int c = 0; c < C; ++c) {
+    m_masks[c].for_each([&](int b) {
+      m_hash ^= Zobrist::key(BitBoard::index_of(b), Color(c + 1));
+    });
+  }
+}
+
+template <size_t W, size_t H, int C>
+void BasicSameGame<W, H, C>::set_column(size_t x,
+                          const std::array<uint64_t, C> &lanes) {
+  for (int c = 0; c < C; ++c) {
+    const uint64_t old_lane = m_masks[c].lane(x);
+    if (old_lane != lanes[c]) {
+      m_hash ^= lane_keys<BitBoard>(x, old_lane ^ lanes[c], Color(c + 1));
+      m_masks[c].set_lane(x, lanes[c]);
+    }
+  }
+}
+
+// NOTE: Only the clusters near the dirty columns are recomputed. A cluster
+// which does not reach the dirty columns nor their immediate neighbours has
+// kept its cells, and none of its cells can have gained a neighbour of the
+// same color, so it is still valid as is.
+template <size_t W, size_t H, int C>
+void BasicSameGame<W, H, C>::compute_clusters() {
+  SG_STATS_TIMER(ComputeClusters);
+
+  const uint64_t near_dirty =
+      (m_dirty_columns | m_dirty_columns << 1 | m_dirty_columns >> 1) &
+      all_columns<W>;
+
+  BitBoard redo;
+  for (size_t x = 0; x < W; ++x) {
+    if (near_dirty >> x & 1) {
+      redo.set_lane(x, BitBoard::LANE_MASK);
+    }
+  }
+
+  // Drop the clusters which need to be recomputed and compact the others.
+  size_t n_kept = 0;
+  for (size_t k = 0; k < m_clusters.size(); ++k) {
+    m_cluster_index[m_clusters[k].rep] = -1;
+    if ((m_cluster_masks[k] & redo).any()) {
+      redo |= m_cluster_masks[k];
+    } else {
+      m_clusters[n_kept] = m_clusters[k];
+      m_cluster_masks[n_kept] = m_cluster_masks[k];
+      ++n_kept;
+    }
+  }
+  m_clusters.resize(n_kept);
+  m_cluster_masks.resize(n_kept);
+
+  for (int c = 0; c < C; ++c) {
+    // Cells without a neighbour of the same color are never part of a
+    // cluster.
+    BitBoard todo = m_masks[c].connected() & redo;
+
+    while (todo.any()) {
+      BitBoard seed;
+      seed.set(todo.lowest());
+
+      const BitBoard mask = BitBoard::flood_fill(seed, m_masks[c]);
+      todo &= ~mask;
+
+      m_clusters.push_back(ClusterInfo{BitBoard::index_of(mask.lowest()),
+                                       mask.count(), Color(c + 1)});
+      m_cluster_masks.push_back(mask);
+    }
+  }
+
+  for (int k = 0; k < m_clusters.size(); ++k) {
+    m_cluster_index[m_clusters[k].rep] = k;
+  }
+}
+
+template <size_t W, size_t H, int C>
+void BasicSameGame<W, H, C>::gravity() {
+  SG_STATS_TIMER(Gravity);
+
+  for (size_t x = 0; x < W; ++x) {
+    if (not(m_dirty_columns >> x & 1)) {
+      continue;
+    }
+
+    // Nothing to do if the column's cells are already packed at the bottom.
+    const uint64_t occ = m_occupied.lane(x);
+    if ((occ & (occ + 1)) == 0) {
+      continue;
+    }
+
+    std::array<uint64_t, C> lanes;
+    for (int c = 0; c < C; ++c) {
+      lanes[c] = Bits::compress(m_masks[c].lane(x), occ);
+    }
+    set_column(x, lanes);
+    m_occupied.set_lane(x, (uint64_t{1} << __builtin_popcountll(occ)) - 1);
+  }
+}
+
+// NOTE: As for the DSU backend, this needs to be called after #gravity(), so
+// that a column is empty exactly when its lane in `m_occupied` is zero. Only
+// the columns emptied by the last move can be new empty columns.
+template <size_t W, size_t H, int C>
+void BasicSameGame<W, H, C>::stack_columns() {
+  SG_STATS_TIMER(StackColumns);
+
+  size_t to = 0;
+  while (to < W && not(m_dirty_columns >> to & 1 &&
+                             m_occupied.lane(to) == 0)) {
+    ++to;
+  }
+
+  if (to == W) {
+    return;
+  }
+
+  // Every column from the first emptied one onwards may change.
+  m_dirty_columns |= all_columns<W> & ~((uint64_t{1} << to) - 1);
+
+  for (size_t x = to + 1; x < W; ++x) {
+    const uint64_t occ = m_occupied.lane(x);
+    if (occ == 0) {
+      continue;
+    }
+    std::array<uint64_t, C> lanes;
+    for (int c = 0; c < C; ++c) {
+      lanes[c] = m_masks[c].lane(x);
+    }
+    set_column(to, lanes);
+    m_occupied.set_lane(to, occ);
+    ++to;
+  }
+
+  for (; to < W; ++to) {
+    set_column(to, {});
+    m_occupied.set_lane(to, 0);
+  }
+}
+
+template <size_t W, size_t H, int C>
+Cluster BasicSameGame<W, H, C>::get_cluster(int i) const {
+  const Color color = get_color(i);
+
+  if (color == Color::Empty) {
+    m_cluster_next[i] = i;
+    return Cluster{i, color, 1, i, m_cluster_next.data()};
+  }
+
+  // The masks of the listed clusters are known from their representative.
+  BitBoard mask;
+  if (const int k = m_cluster_index[i]; k >= 0) {
+    mask = m_cluster_masks[k];
+  } else {
+    BitBoard seed;
+    seed.set(BitBoard::bit_of(i));
+    mask = BitBoard::flood_fill(
+        seed, m_masks[static_cast<std::underlying_type_t<Color>>(color) - 1]);
+  }
+
+  // Link the members in the order of their bits.
+  const int rep = BitBoard::index_of(mask.lowest());
+  int last = rep;
+  size_t size = 0;
+  mask.for_each([&](int b) {
+    m_cluster_next[last] = BitBoard::index_of(b);
+    last = m_cluster_next[last];
+    ++size;
+  });
+  m_cluster_next[last] = rep;
+
+  return Cluster{rep, color, size, rep, m_cluster_next.data()};
+}
+
+template <size_t W, size_t H, int C>
+void BasicSameGame<W, H, C>::clear_cluster(int index) {
+  SG_STATS_TIMER(ClearCluster);
+
+  const ClusterInfo &cluster = m_clusters[m_cluster_index[index]];
+  const BitBoard &mask = m_cluster_masks[m_cluster_index[index]];
+  const auto color = static_cast<std::underlying_type_t<Color>>(cluster.color);
+
+  m_masks[color - 1] ^= mask;
+  m_occupied ^= mask;
+  mask.for_each([&](int b) {
+    m_hash ^= Zobrist::key(BitBoard::index_of(b), cluster.color);
+  });
+
+  ccount[color] -= cluster.size;
+  ccount[static_cast<std::underlying_type_t<Color>>(Color::Empty)] +=
+      cluster.size;
+
+  m_dirty_columns = 0;
+  for (size_t x = 0; x < W; ++x) {
+    m_dirty_columns |= uint64_t{mask.lane(x) != 0} << x;
+  }
+}
+
+template <size_t W, size_t H, int C>
+void BasicSameGame<W, H, C>::apply(const Action &action) {
+
+  if (not is_valid(action)) {
+    std::cerr << "Invalid action: " << action.index << std::endl;
+    throw std::runtime_error("Invalid action");
+  }
+
+  Undo &undo = m_history.emplace_back();
+  undo.state = state();
+  undo.hash = m_hash;
+
+  clear_cluster(action.index);
+  gravity();
+  stack_columns();
+  compute_clusters();
+
+  undo.dirty_columns = m_dirty_columns;
+}
+
+// NOTE: The cells outside of the dirty columns of a move are the same before
+// and after it, so the clusters away from them can be kept when going
+// backwards.
+template <size_t W, size_t H, int C>
+void BasicSameGame<W, H, C>::undo() {
+  assert(not m_history.empty());
+  const Undo &undo = m_history.back();
+
+  m_masks = undo.state.masks;
+  ccount = undo.state.ccount;
+  m_hash = undo.hash;
+  m_occupied = BitBoard{};
+  for (const BitBoard &mask : m_masks) {
+    m_occupied |= mask;
+  }
+
+  m_dirty_columns = undo.dirty_columns;
+  compute_clusters();
+
+  m_history.pop_back();
+}
+
+template <size_t W, size_t H, int C>
+auto BasicSameGame<W, H, C>::state() const -> State {
+  return State{m_masks, ccount};
+}
+
+template <size_t W, size_t H, int C>
+void BasicSameGame<W, H, C>::set_state(const State &state) {
+  m_masks = state.masks;
+  ccount = state.ccount;
+  m_occupied = BitBoard{};
+  for (const BitBoard &mask : m_masks) {
+    m_occupied |= mask;
+  }
+
+  m_history.clear();
+  m_dirty_columns = all_columns<W>;
+  rehash();
+  compute_clusters();
+}
+
+template <size_t W, size_t H, int C>
+int BasicSameGame<W, H, C>::get_color_count(Color c) const {
+  return ccount[static_cast<std::underlying_type_t<Color>>(c)];
+}
+
+template class BasicSameGame<WIDTH, HEIGHT, NB_COLORS>;
+template class BasicSameGame<20, 20, NB_COLORS>;
+
+#endif // SG_BITBOARD
@@ -0,0 +1,192 @@
+#include "solution_cache.h"
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+constexpr char MAGIC[4] = {'S', 'G', 'S', '1'};
+constexpr size_t HEADER_SIZE = 8;
+
+/**
+ * Lock on a whole file, released when it goes out of scope.
+ */
+class FileLock {
+public:
+  FileLock(int fd, int operation) : m_fd{fd} { flock(m_fd, operation); }
+  ~FileLock() { flock(m_fd, LOCK_UN); }
+
+private:
+  int m_fd;
+};
+
+bool write_all(int fd, const uint8_t *data, size_t size) {
+  while (size > 0) {
+    const ssize_t n = ::write(fd, data, size);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return false;
+    }
+    data += n;
+    size -= n;
+  }
+  return true;
+}
+
+} // namespace
+
+SolutionCache::SolutionCache(const std::string &path, const BoardShape &shape)
+    : m_fd{::open(path.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644)},
+      m_data{nullptr}, m_mapped_size{0}, m_indexed_size{HEADER_SIZE} {
+  if (m_fd < 0) {
+    throw std::runtime_error("Failed to open solution cache " + path + ": " +
+                             std::strerror(errno));
+  }
+
+  uint8_t header[HEADER_SIZE] = {};
+  std::memcpy(header, MAGIC, sizeof(MAGIC));
+  header[4] = shape.width;
+  header[5] = shape.height;
+  header[6] = shape.nb_colors;
+
+  bool valid;
+  {
+    // The first process to get there writes the header.
+    FileLock lock{m_fd, LOCK_EX};
+    struct stat st;
+    fstat(m_fd, &st);
+
+    uint8_t found[HEADER_SIZE];
+    if (st.st_size == 0) {
+      valid = write_all(m_fd, header, HEADER_SIZE);
+    } else {
+      valid = pread(m_fd, found, HEADER_SIZE, 0) ==
+                  static_cast<ssize_t>(HEADER_SIZE) &&
+              std::memcmp(found, header, HEADER_SIZE) == 0;
+    }
+  }
+
+  if (not valid) {
+    ::close(m_fd);
+    throw std::runtime_error("Invalid solution cache " + path +
+                             ", or for boards of another shape");
+  }
+}
+
+SolutionCache::~SolutionCache() {
+  unmap();
+  ::close(m_fd);
+}
+
+void SolutionCache::unmap() {
+  if (m_data) {
+    munmap(const_cast<uint8_t *>(m_data), m_mapped_size);
+    m_data = nullptr;
+    m_mapped_size = 0;
+  }
+}
+
+void SolutionCache::refresh() {
+  // The file may also have shrunk, when another process dropped an entry
+  // cut short.
+  struct stat st;
+  if (fstat(m_fd, &st) != 0 ||
+      static_cast<size_t>(st.st_size) == m_mapped_size) {
+    return;
+  }
+
+  unmap();
+  void *data = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, m_fd, 0);
+  if (data == MAP_FAILED) {
+    return;
+  }
+  m_data = static_cast<const uint8_t *>(data);
+  m_mapped_size = st.st_size;
+
+  const uint8_t *p = m_data + m_indexed_size;
+  const uint8_t *const last = m_data + m_mapped_size;
+  GameRecord record;
+  for (const uint8_t *entry = p; Records::parse(p, last, record); entry = p) {
+    const size_t offset = entry - m_data;
+    const auto [it, inserted] =
+        m_index.emplace(record.board_hash, Best{offset, record.score});
+    if (not inserted && record.score > it->second.score) {
+      it->second = Best{offset, record.score};
+    }
+    m_indexed_size = p - m_data;
+  }
+}
+
+bool SolutionCache::lookup(uint64_t board_hash, GameRecord &record) {
+  std::lock_guard<std::mutex> guard{m_mutex};
+  {
+    FileLock lock{m_fd, LOCK_SH};
+    refresh();
+  }
+
+  const auto it = m_index.find(board_hash);
+  if (it == m_index.end() || not m_data) {
+    return false;
+  }
+
+  const uint8_t *p = m_data + it->second.offset;
+  return Records::parse(p, m_data + m_mapped_size, record);
+}
+
+void SolutionCache::drop(uint64_t board_hash, double score) {
+  std::lock_guard<std::mutex> guard{m_mutex};
+  // Another process may have stored a better line meanwhile.
+  if (const auto it = m_index.find(board_hash);
+      it != m_index.end() && it->second.score == score) {
+    m_index.erase(it);
+  }
+}
+
+bool SolutionCache::store(const GameRecord &record) {
+  std::vector<uint8_t> entry;
+  Records::append(record, entry);
+
+  std::lock_guard<std::mutex> guard{m_mutex};
+  FileLock lock{m_fd, LOCK_EX};
+
+  // Another process may have found as good a line meanwhile.
+  refresh();
+  if (const auto it = m_index.find(record.board_hash);
+      it != m_index.end() && it->second.score >= record.score) {
+    return false;
+  }
+
+  // Drop an entry cut short by a crash, which was never indexed. The file
+  // is then shorter than the mapping, which has to go.
+  if (m_indexed_size < m_mapped_size) {
+    unmap();
+    if (ftruncate(m_fd, m_indexed_size) != 0) {
+      return false;
+    }
+  }
+
+  if (not write_all(m_fd, entry.data(), entry.size())) {
+    return false;
+  }
+  refresh();
+  return true;
+}
+
+size_t SolutionCache::size() {
+  std::lock_guard<std::mutex> guard{m_mutex};
+  {
+    FileLock lock{m_fd, LOCK_SH};
+    refresh();
+  }
+  return m_index.size();
+}
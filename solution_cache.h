@@ -0,0 +1,139 @@
+#ifndef SOLUTION_CACHE_H_
+#define SOLUTION_CACHE_H_
+
+#include "types.h"
+#include "game_record.h"
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Best known line of every board met so far, kept on disk from one run to
+ * the next.
+ *
+ * The file is a log which is only ever appended to: an 8 bytes header, the
+ * magic "SGS1" and the width, the height and the number of colors of the
+ * boards as one byte each, a zero byte, followed by entries laid out as the
+ * records of Records::write(). A board may have several entries, the one
+ * with the best score wins.
+ *
+ * The file is memory-mapped for lookups, and remapped whenever it grew.
+ * Several processes can share it: appending takes an exclusive lock on the
+ * file and reading its new entries a shared one. An entry cut short, by a
+ * crash, is ignored along with whatever follows it.
+ *
+ * All methods are thread-safe.
+ */
+class SolutionCache {
+public:
+  /**
+   * Open the cache of `path`, creating it if it does not exist. Throws
+   * std::runtime_error if it cannot be opened or holds boards of another
+   * shape.
+   */
+  SolutionCache(const std::string &path, const BoardShape &shape);
+  ~SolutionCache();
+
+  SolutionCache(const SolutionCache &) = delete;
+  SolutionCache &operator=(const SolutionCache &) = delete;
+
+  /**
+   * Look up the best line known for a board.
+   *
+   * @Param board_hash  The hash of the starting board.
+   * @Param record  Receives the line on a hit.
+   */
+  bool lookup(uint64_t board_hash, GameRecord &record);
+
+  /**
+   * Look up the best line known for the position of `sg`, checking it by
+   * replaying it on a copy of the board.
+   *
+   * @Param line  Receives the moves of the line.
+   * @Param score  Receives the score of the line, from `sg`.
+   * @Return false unless a valid line is known. An invalid line, whose
+   *         replay does not give the score it claims, is forgotten so that
+   *         store() does not compare with its score.
+   */
+  template <typename Game>
+  bool lookup(const Game &sg, std::vector<Action> &line, double &score);
+
+  /**
+   * Append a line unless a line as good is already known for its board.
+   *
+   * @Return  Whether the line was appended.
+   */
+  bool store(const GameRecord &record);
+
+  /**
+   * Number of boards with a known line.
+   */
+  size_t size();
+
+private:
+  std::mutex m_mutex;
+  int m_fd;
+
+  // Mapping of the first `m_mapped_size` bytes of the file.
+  const uint8_t *m_data;
+  size_t m_mapped_size;
+  // The entries before this offset are in `m_index`.
+  size_t m_indexed_size;
+
+  struct Best {
+    size_t offset;
+    double score;
+  };
+  std::unordered_map<uint64_t, Best> m_index;
+
+  /**
+   * Map and index the entries appended since the last call. The caller
+   * holds `m_mutex` and a lock on the file.
+   */
+  void refresh();
+
+  /**
+   * Drop the mapping of the file, if any.
+   */
+  void unmap();
+
+  /**
+   * Forget the best entry of a board if it claims the given score, the
+   * entries before it being lost as well.
+   */
+  void drop(uint64_t board_hash, double score);
+};
+
+template <typename Game>
+bool SolutionCache::lookup(const Game &sg, std::vector<Action> &line,
+                           double &score) {
+  GameRecord known;
+  if (not lookup(sg.hash(), known)) {
+    return false;
+  }
+
+  Game copy;
+  copy.set_state(sg.state());
+  line.clear();
+  score = 0.0;
+  for (const uint8_t move : known.moves) {
+    Action action;
+    if (not Records::decode_move(copy, move, action)) {
+      drop(known.board_hash, known.score);
+      return false;
+    }
+    score += copy.score(action);
+    line.push_back(action);
+    copy.apply(action);
+  }
+  if (score != known.score) {
+    drop(known.board_hash, known.score);
+    return false;
+  }
+  return true;
+}
+
+#endif // SOLUTION_CACHE_H_
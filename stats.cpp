@@ -0,0 +1,201 @@
+#ifdef SG_STATS
+
+#include "stats.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Table = std::array<Stats::Histogram, Stats::N_IDS>;
+
+const std::array<const char *, Stats::N_IDS> names = {
+    "clear_cluster",     "gravity",
+    "stack_columns",     "update_clusters",
+    "compute_clusters",  "decision",
+    "DSU::unite (size)", "DSU::find_rep (depth)"};
+
+bool is_timer(Stats::Id id) { return id <= Stats::Decision; }
+
+/**
+ * The tables of the live threads, and the sum of those of the threads
+ * which are done.
+ */
+struct Registry {
+  std::mutex mutex;
+  std::vector<Table *> live;
+  Table retired{};
+};
+
+Registry &registry() {
+  static Registry ret;
+  return ret;
+}
+
+struct Local {
+  Table table{};
+
+  Local() {
+    Registry &r = registry();
+    const std::lock_guard<std::mutex> lock{r.mutex};
+    r.live.push_back(&table);
+  }
+
+  ~Local() {
+    Registry &r = registry();
+    const std::lock_guard<std::mutex> lock{r.mutex};
+    for (int id = 0; id < Stats::N_IDS; ++id) {
+      r.retired[id].merge(table[id]);
+    }
+    r.live.erase(std::find(r.live.begin(), r.live.end(), &table));
+  }
+};
+
+thread_local Local local;
+
+} // namespace
+
+namespace Stats {
+
+void Histogram::add(uint64_t value) {
+  min = count == 0 ? value : std::min(min, value);
+  max = std::max(max, value);
+  ++count;
+  sum += value;
+  ++buckets[bucket_of(value)];
+}
+
+void Histogram::merge(const Histogram &other) {
+  if (other.count == 0) {
+    return;
+  }
+  min = count == 0 ? other.min : std::min(min, other.min);
+  max = std::max(max, other.max);
+  count += other.count;
+  sum += other.sum;
+  for (int b = 0; b < N_BUCKETS; ++b) {
+    buckets[b] += other.buckets[b];
+  }
+}
+
+uint64_t Histogram::percentile(double p) const {
+  const uint64_t rank = std::max<uint64_t>(1, p * count + 0.5);
+  uint64_t seen = 0;
+  for (int b = 0; b < N_BUCKETS; ++b) {
+    if ((seen += buckets[b]) >= rank) {
+      return std::clamp(bucket_min(b), min, max);
+    }
+  }
+  return max;
+}
+
+// NOTE: The values below SUB_BUCKETS have a bucket each. Above, the bucket is
+// given by the position of the highest bit and the SUB_BITS bits after it.
+int Histogram::bucket_of(uint64_t value) {
+  if (value < SUB_BUCKETS) {
+    return value;
+  }
+  const int high = 63 - __builtin_clzll(value);
+  const int sub = value >> (high - SUB_BITS) & (SUB_BUCKETS - 1);
+  return SUB_BUCKETS * (high - SUB_BITS + 1) + sub;
+}
+
+uint64_t Histogram::bucket_min(int bucket) {
+  if (bucket < SUB_BUCKETS) {
+    return bucket;
+  }
+  const int high = bucket / SUB_BUCKETS + SUB_BITS - 1;
+  const uint64_t sub = bucket % SUB_BUCKETS;
+  return (SUB_BUCKETS + sub) << (high - SUB_BITS);
+}
+
+void record(Id id, uint64_t value) { local.table[id].add(value); }
+
+Histogram total(Id id) {
+  Registry &r = registry();
+  const std::lock_guard<std::mutex> lock{r.mutex};
+
+  Histogram ret = r.retired[id];
+  for (const Table *table : r.live) {
+    ret.merge((*table)[id]);
+  }
+  return ret;
+}
+
+void reset() {
+  Registry &r = registry();
+  const std::lock_guard<std::mutex> lock{r.mutex};
+
+  r.retired = Table{};
+  for (Table *table : r.live) {
+    *table = Table{};
+  }
+}
+
+void report(std::ostream &os) {
+  std::array<Histogram, N_IDS> totals;
+  for (int id = 0; id < N_IDS; ++id) {
+    totals[id] = total(Id(id));
+  }
+
+  os << '\n'
+     << std::left << std::setw(24) << "Statistic" << std::right
+     << std::setw(12) << "Count" << std::setw(12) << "Total" << std::setw(10)
+     << "Mean" << std::setw(10) << "p50" << std::setw(10) << "p90"
+     << std::setw(10) << "p99" << std::setw(10) << "Max" << '\n';
+
+  for (int id = 0; id < N_IDS; ++id) {
+    const Histogram &h = totals[id];
+    if (h.count == 0) {
+      continue;
+    }
+
+    // The durations are in nanoseconds, their total in milliseconds.
+    os << std::left << std::setw(24) << names[id] << std::right
+       << std::setw(12) << h.count << std::fixed << std::setw(12)
+       << std::setprecision(is_timer(Id(id)) ? 1 : 0)
+       << (is_timer(Id(id)) ? h.sum * 1e-6 : h.sum) << std::setprecision(1)
+       << std::setw(10) << double(h.sum) / h.count << std::setw(10)
+       << h.percentile(0.5) << std::setw(10) << h.percentile(0.9)
+       << std::setw(10) << h.percentile(0.99) << std::setw(10) << h.max
+       << '\n';
+  }
+
+  for (int id = 0; id < N_IDS; ++id) {
+    const Histogram &h = totals[id];
+    if (h.count == 0) {
+      continue;
+    }
+
+    os << '\n' << names[id] << (is_timer(Id(id)) ? " (ns)" : "") << '\n';
+
+    // One line per power of two, which is plenty to see the shape. Line 0
+    // holds the zeros, and line k > 0 the values in [2^(k-1), 2^k).
+    std::array<uint64_t, 65> lines{};
+    for (int b = 0; b < Histogram::N_BUCKETS; ++b) {
+      const uint64_t lo = Histogram::bucket_min(b);
+      lines[lo == 0 ? 0 : 64 - __builtin_clzll(lo)] += h.buckets[b];
+    }
+
+    constexpr int BAR_WIDTH = 50;
+    for (int k = 0; k < 65; ++k) {
+      if (lines[k] == 0) {
+        continue;
+      }
+      const uint64_t lo = k == 0 ? 0 : uint64_t{1} << (k - 1);
+      os << "  >= " << std::setw(12) << lo << std::setw(12) << lines[k]
+         << "  "
+         << std::string((BAR_WIDTH * lines[k] + h.count - 1) / h.count, '#')
+         << '\n';
+    }
+  }
+  os << std::flush;
+}
+
+} // namespace Stats
+
+#endif // SG_STATS
@@ -0,0 +1,116 @@
+#ifndef STATS_H_
+#define STATS_H_
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+
+/**
+ * Counters and timers of the hot paths, to see where the time goes in real
+ * runs. They are only collected when built with SG_STATS, see the
+ * SG_STATS_TIMER() and SG_STATS_RECORD() macros below, which expand to
+ * nothing otherwise.
+ *
+ * Every thread records into tables of its own, which are summed up by
+ * #report().
+ */
+namespace Stats {
+
+enum Id {
+  // Nanoseconds spent in each step of BasicSameGame::apply().
+  ClearCluster,
+  Gravity,
+  StackColumns,
+  UpdateClusters,
+  ComputeClusters,
+  // Nanoseconds taken by the policy to choose each move of play().
+  Decision,
+  // Size of the cluster holding both cells after each call to DSU::unite().
+  Unite,
+  // Number of parents walked by each call to DSU::find_rep().
+  FindDepth,
+  N_IDS
+};
+
+/**
+ * Distribution of the values recorded for an #Id. The buckets split each
+ * power of two in SUB_BUCKETS, so that the percentiles are within 25% of
+ * the actual values.
+ */
+struct Histogram {
+  static constexpr int SUB_BITS = 2;
+  static constexpr int SUB_BUCKETS = 1 << SUB_BITS;
+  static constexpr int N_BUCKETS = SUB_BUCKETS * (64 - SUB_BITS + 1);
+
+  uint64_t count;
+  uint64_t sum;
+  uint64_t min;
+  uint64_t max;
+  std::array<uint64_t, N_BUCKETS> buckets;
+
+  void add(uint64_t value);
+  void merge(const Histogram &other);
+
+  /**
+   * Lowest value of the bucket holding the p-th quantile, 0 <= p <= 1.
+   */
+  uint64_t percentile(double p) const;
+
+  static int bucket_of(uint64_t value);
+  static uint64_t bucket_min(int bucket);
+};
+
+/**
+ * Record a value in the tables of the calling thread.
+ */
+void record(Id id, uint64_t value);
+
+/**
+ * The values recorded so far by every thread.
+ *
+ * Note: The threads which are still alive should be idle, as their tables
+ * are read without synchronization.
+ */
+Histogram total(Id id);
+
+/**
+ * Forget the values recorded so far, with the same caveat as #total().
+ */
+void reset();
+
+/**
+ * Print a summary of every #Id, followed by its histogram.
+ */
+void report(std::ostream &os);
+
+/**
+ * Records the nanoseconds between its construction and its destruction.
+ */
+class Timer {
+public:
+  explicit Timer(Id id) : m_id{id}, m_start{Clock::now()} {}
+  ~Timer() {
+    record(m_id, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                     Clock::now() - m_start)
+                     .count());
+  }
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  Id m_id;
+  Clock::time_point m_start;
+};
+
+} // namespace Stats
+
+#ifdef SG_STATS
+#define SG_STATS_TIMER(id) const Stats::Timer sg_stats_timer_{Stats::id}
+#define SG_STATS_RECORD(id, value) Stats::record(Stats::id, value)
+#else
+#define SG_STATS_TIMER(id)
+#define SG_STATS_RECORD(id, value)
+#endif
+
+#endif // STATS_H_
@@ -0,0 +1,111 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+
+namespace {
+
+// Index of the worker running on the current thread, if any.
+thread_local const ThreadPool *tl_pool = nullptr;
+thread_local size_t tl_worker = 0;
+
+} // namespace
+
+ThreadPool::ThreadPool(size_t n_threads)
+    : m_queued{0}, m_pending{0}, m_next_queue{0}, m_stop{false} {
+  n_threads = std::max<size_t>(n_threads, 1);
+
+  for (size_t i = 0; i < n_threads; ++i) {
+    m_queues.push_back(std::make_unique<Queue>());
+  }
+  for (size_t i = 0; i < n_threads; ++i) {
+    m_threads.emplace_back([this, i] { work(i); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    m_stop = true;
+  }
+  m_work_cv.notify_all();
+
+  for (std::thread &thread : m_threads) {
+    thread.join();
+  }
+}
+
+void ThreadPool::submit(Task task) {
+  size_t i;
+  {
+    // Counting the task as queued a bit early only means that an idle
+    // worker may look at the queues once more before it is pushed.
+    std::lock_guard<std::mutex> lock{m_mutex};
+    ++m_pending;
+    ++m_queued;
+    i = tl_pool == this ? tl_worker : m_next_queue++ % m_queues.size();
+  }
+
+  {
+    Queue &queue = *m_queues[i];
+    std::lock_guard<std::mutex> lock{queue.mutex};
+    queue.tasks.push_back(std::move(task));
+  }
+  m_work_cv.notify_one();
+}
+
+void ThreadPool::wait() {
+  std::unique_lock<std::mutex> lock{m_mutex};
+  m_done_cv.wait(lock, [this] { return m_pending == 0; });
+}
+
+bool ThreadPool::pop(size_t i, Task &task) {
+  const size_t n = m_queues.size();
+
+  for (size_t k = 0; k < n; ++k) {
+    Queue &queue = *m_queues[(i + k) % n];
+    std::lock_guard<std::mutex> lock{queue.mutex};
+
+    if (queue.tasks.empty()) {
+      continue;
+    }
+
+    if (k == 0) {
+      task = std::move(queue.tasks.back());
+      queue.tasks.pop_back();
+    } else {
+      task = std::move(queue.tasks.front());
+      queue.tasks.pop_front();
+    }
+    --m_queued;
+    return true;
+  }
+
+  return false;
+}
+
+void ThreadPool::work(size_t i) {
+  tl_pool = this;
+  tl_worker = i;
+
+  Task task;
+
+  while (true) {
+    if (pop(i, task)) {
+      task(i);
+      task = nullptr;
+
+      std::lock_guard<std::mutex> lock{m_mutex};
+      if (--m_pending == 0) {
+        m_done_cv.notify_all();
+      }
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock{m_mutex};
+    m_work_cv.wait(lock, [this] { return m_stop || m_queued > 0; });
+
+    if (m_stop && m_queued == 0) {
+      return;
+    }
+  }
+}
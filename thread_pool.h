@@ -0,0 +1,75 @@
+#ifndef THREAD_POOL_H_
+#define THREAD_POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Fixed set of worker threads balanced by work stealing.
+ *
+ * Every worker owns a queue of tasks. It runs the most recently pushed
+ * tasks of its own queue first, and when it runs out of work it steals the
+ * oldest tasks of the other queues.
+ */
+class ThreadPool {
+public:
+  /**
+   * A task receives the index of the worker which runs it, in [0, size()).
+   */
+  using Task = std::function<void(size_t)>;
+
+  explicit ThreadPool(size_t n_threads = std::thread::hardware_concurrency());
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  /**
+   * Schedule a task. Tasks submitted from a worker go to its own queue,
+   * the others are spread over all queues.
+   */
+  void submit(Task task);
+
+  /**
+   * Block until every submitted task has completed.
+   */
+  void wait();
+
+  size_t size() const { return m_threads.size(); }
+
+private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  std::vector<std::unique_ptr<Queue>> m_queues;
+  std::vector<std::thread> m_threads;
+
+  std::mutex m_mutex;
+  std::condition_variable m_work_cv;
+  std::condition_variable m_done_cv;
+
+  // Tasks waiting in the queues, and tasks submitted but not completed.
+  std::atomic<size_t> m_queued;
+  size_t m_pending;
+  size_t m_next_queue;
+  bool m_stop;
+
+  void work(size_t i);
+
+  /**
+   * Take a task from the back of queue i or, failing that, from the front
+   * of another queue.
+   */
+  bool pop(size_t i, Task &task);
+};
+
+#endif // THREAD_POOL_H_
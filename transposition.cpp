@@ -0,0 +1,77 @@
+#include "transposition.h"
+
+#include <cstring>
+
+namespace {
+
+// The score is stored as a float in the upper half of the data word, and
+// the depth plus one in its lower half, so that a data word of 0 always
+// means an empty slot. Scores are integers far below 2^24, so the conversion
+// is exact.
+inline uint64_t pack(double score, int depth) {
+  const float f = static_cast<float>(score);
+  uint32_t bits;
+  std::memcpy(&bits, &f, sizeof bits);
+  return uint64_t{bits} << 32 | static_cast<uint32_t>(depth + 1);
+}
+
+inline TranspositionTable::Entry unpack(uint64_t data) {
+  const uint32_t bits = data >> 32;
+  float f;
+  std::memcpy(&f, &bits, sizeof f);
+  return {f, static_cast<int32_t>(data & 0xffffffff) - 1};
+}
+
+inline size_t round_up_pow2(size_t n) {
+  size_t ret = 1;
+  while (ret < n)
+    ret <<= 1;
+  return ret;
+}
+
+} // namespace
+
+TranspositionTable::TranspositionTable(size_t size)
+    : m_slots{new Slot[round_up_pow2(size)]}, m_mask{round_up_pow2(size) - 1} {
+  clear();
+}
+
+bool TranspositionTable::probe(uint64_t key, Entry &entry) const {
+  const Slot &slot = m_slots[key & m_mask];
+  const uint64_t data = slot.data.load(std::memory_order_relaxed);
+  const uint64_t check = slot.check.load(std::memory_order_relaxed);
+
+  if ((check ^ data) != key || data == 0) {
+    return false;
+  }
+
+  entry = unpack(data);
+  return true;
+}
+
+void TranspositionTable::store(uint64_t key, double score, int depth) {
+  Slot &slot = m_slots[key & m_mask];
+  const uint64_t old_data = slot.data.load(std::memory_order_relaxed);
+  const uint64_t old_check = slot.check.load(std::memory_order_relaxed);
+
+  if (old_data != 0) {
+    const Entry old = unpack(old_data);
+    const bool same_key = (old_check ^ old_data) == key;
+
+    if (old.depth > depth ||
+        (same_key && old.depth == depth && old.score >= score)) {
+      return;
+    }
+  }
+
+  const uint64_t data = pack(score, depth);
+  slot.data.store(data, std::memory_order_relaxed);
+  slot.check.store(key ^ data, std::memory_order_relaxed);
+}
+
+void TranspositionTable::clear() {
+  for (size_t i = 0; i <= m_mask; ++i) {
+    m_slots[i].data.store(0, std::memory_order_relaxed);
+    m_slots[i].check.store(0, std::memory_order_relaxed);
+  }
+}
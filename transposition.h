@@ -0,0 +1,66 @@
+#ifndef TRANSPOSITION_H_
+#define TRANSPOSITION_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+/**
+ * Fixed size hash table of search results, keyed by #SameGame::hash().
+ *
+ * The table can be shared by several threads without locking: every slot
+ * stores its data along with the xor of the data and the key, so that a slot
+ * torn by concurrent writes fails the key check and reads as a miss.
+ */
+class TranspositionTable {
+public:
+  struct Entry {
+    double score;
+    int depth;
+  };
+
+  /**
+   * @Param size  The number of slots, rounded up to a power of two.
+   */
+  explicit TranspositionTable(size_t size);
+
+  /**
+   * Look a position up.
+   *
+   * @Param key  The hash of the position.
+   * @Param entry  Receives the stored entry on a hit.
+   * @Return  Whether an entry was found for the position.
+   */
+  bool probe(uint64_t key, Entry &entry) const;
+
+  /**
+   * Record the best score known for a position. The slot is overwritten
+   * unless it holds a result of greater depth, or an equally deep one with
+   * a better score for the same position.
+   *
+   * @Param key  The hash of the position.
+   * @Param score  The best score known.
+   * @Param depth  The (non-negative) depth of the search which produced
+   *               the score.
+   */
+  void store(uint64_t key, double score, int depth);
+
+  /**
+   * Empty all slots.
+   */
+  void clear();
+
+  size_t size() const { return m_mask + 1; }
+
+private:
+  struct Slot {
+    std::atomic<uint64_t> check;
+    std::atomic<uint64_t> data;
+  };
+
+  std::unique_ptr<Slot[]> m_slots;
+  size_t m_mask;
+};
+
+#endif // TRANSPOSITION_H_
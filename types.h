@@ -1,13 +1,38 @@
 #ifndef TYPES_H_
 #define TYPES_H_
 
+#include <array>
 #include <cstddef>
+#include <cstdint>
 
 constexpr int NB_COLORS = 5;
 
-enum class Color { Empty = 0, Nb = NB_COLORS + 1 };
+// Most colors a board can have, a cell fitting on 3 bits.
+constexpr int MAX_COLORS = 7;
+
+enum class Color : uint8_t { Empty = 0, Nb = NB_COLORS + 1 };
 
 constexpr size_t WIDTH = 15;
 constexpr size_t HEIGHT = 15;
 
+// Most cells a board can have.
+constexpr size_t MAX_CELLS = 32 * 32;
+
+/**
+ * Colors of the cells of a W x H board, indexed by x + y * W where y = 0 is
+ * the top row.
+ */
+template <size_t W, size_t H> using BasicBoard = std::array<Color, W * H>;
+
+using Board = BasicBoard<WIDTH, HEIGHT>;
+
+/**
+ * Dimensions and number of colors of a board.
+ */
+struct BoardShape {
+  size_t width;
+  size_t height;
+  int nb_colors;
+};
+
 #endif // TYPES_H_
@@ -0,0 +1,120 @@
+#include "vec_env.h"
+#include "board_gen.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+template <typename Game>
+BasicVecEnv<Game>::BasicVecEnv(size_t n_envs, BoardSource source,
+                               size_t n_threads)
+    : m_source{std::move(source)}, m_pool{n_threads}, m_games(n_envs),
+      m_seeds(n_envs, 0), m_actions(n_envs, Action{-1}),
+      m_rewards(n_envs, 0.0f), m_dones(n_envs, 0),
+      m_masks(n_envs * n_actions(), 0), m_boards(m_pool.size()) {}
+
+template <typename Game>
+template <typename F>
+void BasicVecEnv<Game>::for_each_env(F f) {
+  // A few chunks per worker, so that the slower games even out.
+  const size_t n_chunks = std::min(size(), 4 * m_pool.size());
+
+  for (size_t k = 0; k < n_chunks; ++k) {
+    m_pool.submit([this, &f, k, n_chunks](size_t worker) {
+      const size_t first = k * size() / n_chunks;
+      const size_t last = (k + 1) * size() / n_chunks;
+      for (size_t i = first; i < last; ++i) {
+        f(worker, i);
+      }
+    });
+  }
+  m_pool.wait();
+}
+
+template <typename Game> void BasicVecEnv<Game>::reset(const uint64_t *seeds) {
+  std::copy(seeds, seeds + size(), m_seeds.begin());
+
+  for_each_env([&](size_t worker, size_t i) {
+    restart(i, m_boards[worker]);
+    m_rewards[i] = 0.0f;
+    m_dones[i] = 0;
+  });
+}
+
+template <typename Game> void BasicVecEnv<Game>::step(const int32_t *actions) {
+  // The games only take the representatives of the clusters.
+  for (size_t i = 0; i < size(); ++i) {
+    const bool in_range =
+        actions[i] >= 0 && actions[i] < static_cast<int32_t>(n_actions());
+    if (in_range) {
+      m_actions[i] = Action{m_games[i].get_cluster(actions[i]).rep};
+    }
+    if (not in_range || not m_games[i].is_valid(m_actions[i])) {
+      throw std::invalid_argument("Invalid action " +
+                                  std::to_string(actions[i]) +
+                                  " in environment " + std::to_string(i));
+    }
+  }
+
+  for_each_env([&](size_t worker, size_t i) {
+    Game &sg = m_games[i];
+    const Action action = m_actions[i];
+
+    m_rewards[i] = sg.score(action);
+    sg.apply(action);
+
+    m_dones[i] = sg.clusters().empty();
+    if (m_dones[i]) {
+      restart(i, m_boards[worker]);
+    } else {
+      update_mask(i);
+    }
+  });
+}
+
+template <typename Game>
+template <typename T>
+void BasicVecEnv<Game>::observe(T *out) {
+  for_each_env([&](size_t, size_t i) {
+    Observation::encode(m_games[i], out + i * Observation::size<Game>());
+  });
+}
+
+template <typename Game>
+void BasicVecEnv<Game>::restart(size_t i, Board &board) {
+  m_source(m_seeds[i], board);
+  m_seeds[i] += size();
+
+  m_games[i].load(board);
+  update_mask(i);
+}
+
+template <typename Game> void BasicVecEnv<Game>::update_mask(size_t i) {
+  const Game &sg = m_games[i];
+  uint8_t *const mask = m_masks.data() + i * n_actions();
+
+  std::fill(mask, mask + n_actions(), 0);
+  for (const ClusterInfo &info : sg.clusters()) {
+    for (const int cell : sg.get_cluster(info.rep)) {
+      mask[cell] = 1;
+    }
+  }
+}
+
+template <typename Game>
+void BasicVecEnv<Game>::random_board(uint64_t seed, Board &board) {
+  const BoardGenerator generator{
+      BoardShape{Game::width(), Game::height(), Game::nb_colors()}, seed};
+  generator.generate(0, board);
+}
+
+template class BasicVecEnv<BasicSameGame<WIDTH, HEIGHT, NB_COLORS>>;
+template class BasicVecEnv<BasicSameGame<20, 20, NB_COLORS>>;
+
+template void
+BasicVecEnv<BasicSameGame<WIDTH, HEIGHT, NB_COLORS>>::observe(float *);
+template void
+BasicVecEnv<BasicSameGame<WIDTH, HEIGHT, NB_COLORS>>::observe(uint8_t *);
+template void BasicVecEnv<BasicSameGame<20, 20, NB_COLORS>>::observe(float *);
+template void
+BasicVecEnv<BasicSameGame<20, 20, NB_COLORS>>::observe(uint8_t *);
@@ -0,0 +1,134 @@
+#ifndef VEC_ENV_H_
+#define VEC_ENV_H_
+
+#include "observation.h"
+#include "samegame.h"
+#include "thread_pool.h"
+
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <vector>
+
+/**
+ * A batch of games stepped together, as a vectorized environment for
+ * reinforcement learning.
+ *
+ * The action of an environment is the index of any cell of the cluster to
+ * remove, in [0, W * H), and its reward is the score of the move. After
+ * every #reset() and #step(), the results for all environments are laid out
+ * contiguously, environment after environment:
+ *  - #rewards(): one float per environment,
+ *  - #dones(): one byte per environment, 1 if its game just ended,
+ *  - #masks(): W * H bytes per environment, 1 for the valid actions.
+ *
+ * An environment whose game ends starts a new one at once, so that its mask
+ * is already the one of the new board. The boards come from a #BoardSource,
+ * environment i drawing the seeds seeds[i], seeds[i] + N, seeds[i] + 2N, ...
+ * from the seeds of the last #reset() where N is the number of
+ * environments.
+ *
+ * The environments are stepped in parallel on a #ThreadPool.
+ */
+template <typename Game> class BasicVecEnv {
+public:
+  using Board = typename Game::Board;
+
+  /**
+   * Fills a board from a seed, deterministically.
+   */
+  using BoardSource = std::function<void(uint64_t seed, Board &board)>;
+
+  /**
+   * @Param n_envs  The number of environments.
+   * @Param source  Where the boards come from.
+   * @Param n_threads  The number of threads stepping the environments.
+   */
+  explicit BasicVecEnv(
+      size_t n_envs, BoardSource source = random_board,
+      size_t n_threads = std::thread::hardware_concurrency());
+
+  /**
+   * Start a new game in every environment, from the board of the given
+   * seed. The rewards and done flags are cleared.
+   *
+   * @Param seeds  One seed per environment.
+   */
+  void reset(const uint64_t *seeds);
+
+  /**
+   * Play one action in every environment. Throws std::invalid_argument,
+   * before any environment is stepped, if an action is not valid.
+   *
+   * @Param actions  One action per environment.
+   */
+  void step(const int32_t *actions);
+
+  /**
+   * Write the observations of all environments to `out`, which holds
+   * size() * Observation::size<Game>() values, see observation.h.
+   *
+   * @Param T  float or uint8_t.
+   */
+  template <typename T> void observe(T *out);
+
+  const float *rewards() const { return m_rewards.data(); }
+  const uint8_t *dones() const { return m_dones.data(); }
+  const uint8_t *masks() const { return m_masks.data(); }
+
+  /**
+   * The game of environment i.
+   */
+  const Game &game(size_t i) const { return m_games[i]; }
+
+  size_t size() const { return m_games.size(); }
+
+  static constexpr size_t n_actions() {
+    return Game::width() * Game::height();
+  }
+
+  /**
+   * Board whose cells are drawn uniformly among the colors, the first of
+   * the #BoardGenerator with this seed.
+   */
+  static void random_board(uint64_t seed, Board &board);
+
+private:
+  BoardSource m_source;
+  ThreadPool m_pool;
+
+  std::vector<Game> m_games;
+  // Seed of the next board of each environment.
+  std::vector<uint64_t> m_seeds;
+  // Representative of the cluster played in each environment.
+  std::vector<Action> m_actions;
+
+  std::vector<float> m_rewards;
+  std::vector<uint8_t> m_dones;
+  std::vector<uint8_t> m_masks;
+
+  // Scratch board of each worker of the pool.
+  std::vector<Board> m_boards;
+
+  /**
+   * Run `f(worker, i)` for every environment i, on the pool.
+   */
+  template <typename F> void for_each_env(F f);
+
+  /**
+   * Load the next board of environment i.
+   */
+  void restart(size_t i, Board &board);
+
+  /**
+   * Write the valid actions of environment i to its mask.
+   */
+  void update_mask(size_t i);
+};
+
+using VecEnv = BasicVecEnv<SameGame>;
+
+extern template class BasicVecEnv<BasicSameGame<WIDTH, HEIGHT, NB_COLORS>>;
+extern template class BasicVecEnv<BasicSameGame<20, 20, NB_COLORS>>;
+
+#endif // VEC_ENV_H_
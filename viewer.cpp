@@ -6,11 +6,13 @@
 #include <sstream>
 
 namespace {
-std::ostream &fmt_cell(std::ostream &out, int idx, const SameGame &sg,
+template <typename Game>
+std::ostream &fmt_cell(std::ostream &out, int idx, const Game &sg,
                        int highlight_cluster = -1);
 } // namespace
 
-void Viewer::print(std::ostream &out, const SameGame &sg) {
+template <size_t W, size_t H, int C>
+void Viewer::print(std::ostream &out, const BasicSameGame<W, H, C> &sg) {
   const size_t height = sg.height();
   const size_t width = sg.width();
 
@@ -100,8 +102,8 @@ inline Shape get_shape(const int idx, const Cluster &cluster,
                        const Cluster &cluster_hl) {
 
   const bool is_empty = cluster.color == Color::Empty;
-  const bool is_trivial = cluster.members.size() < 2;
-  const bool is_nontrivial = cluster.members.size() > 1;
+  const bool is_trivial = cluster.size() < 2;
+  const bool is_nontrivial = cluster.size() > 1;
   const bool is_rep = is_nontrivial && idx == cluster.rep;
   // const bool is_hl = std::count(cluster_hl.begin(), cluster_hl.end(), idx);
 
@@ -113,20 +115,26 @@ inline Shape get_shape(const int idx, const Cluster &cluster,
   return shape;
 }
 
-std::ostream &fmt_cell(std::ostream &out, int idx, const SameGame &sg,
+template <typename Game>
+std::ostream &fmt_cell(std::ostream &out, int idx, const Game &sg,
                        int highlight_cluster) {
   static int last_hl_idx = -1;
-  static Cluster cluster_hl = Cluster{-1};
+  static Cluster cluster_hl;
 
   if (const bool cluster_hl_dirty = highlight_cluster != last_hl_idx;
       cluster_hl_dirty) {
     cluster_hl = sg.get_cluster(last_hl_idx = highlight_cluster);
   }
 
-  const Cluster &cluster = sg.get_cluster(idx);
+  const Cluster cluster = sg.get_cluster(idx);
 
   return with_color(cluster.color,
                     shape_unicode(get_shape(idx, cluster, cluster_hl)), out);
 }
 
 } // namespace
+
+template void Viewer::print(std::ostream &,
+                            const BasicSameGame<WIDTH, HEIGHT, NB_COLORS> &);
+template void Viewer::print(std::ostream &,
+                            const BasicSameGame<20, 20, NB_COLORS> &);
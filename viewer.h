@@ -1,13 +1,16 @@
 #ifndef VIEWER_H_
 #define VIEWER_H_
 
+#include <cstddef>
+#include <iosfwd>
 #include <string>
 
-class SameGame;
+template <size_t W, size_t H, int C> class BasicSameGame;
 
 namespace Viewer {
 
-void print(std::ostream &out, const SameGame &sg);
+template <size_t W, size_t H, int C>
+void print(std::ostream &out, const BasicSameGame<W, H, C> &sg);
 
 } // namespace Viewer
 
@@ -0,0 +1,55 @@
+#ifndef ZOBRIST_H_
+#define ZOBRIST_H_
+
+#include "types.h"
+
+#include <array>
+#include <cstdint>
+#include <type_traits>
+
+/**
+ * Zobrist keys for hashing boards.
+ *
+ * The hash of a board is the xor of the keys of its cells, the key of an
+ * empty cell being 0. Cells are indexed as in #BasicSameGame, so that both of
+ * its backends agree on the hash of a board.
+ */
+namespace Zobrist {
+
+namespace detail {
+
+constexpr uint64_t splitmix64(uint64_t &state) {
+  uint64_t z = (state += 0x9e3779b97f4a7c15);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+  return z ^ (z >> 31);
+}
+
+using Table = std::array<std::array<uint64_t, MAX_COLORS + 1>, MAX_CELLS>;
+
+constexpr Table make_table() {
+  Table table{};
+  uint64_t state = 0x5a4d6547616d65; // Any fixed seed will do.
+  for (size_t i = 0; i < MAX_CELLS; ++i) {
+    table[i][0] = 0;
+    for (size_t c = 1; c < MAX_COLORS + 1; ++c) {
+      table[i][c] = splitmix64(state);
+    }
+  }
+  return table;
+}
+
+} // namespace detail
+
+inline constexpr detail::Table table = detail::make_table();
+
+/**
+ * Key of the cell at index i when it has color c.
+ */
+inline uint64_t key(int i, Color c) {
+  return table[i][static_cast<std::underlying_type_t<Color>>(c)];
+}
+
+} // namespace Zobrist
+
+#endif // ZOBRIST_H_